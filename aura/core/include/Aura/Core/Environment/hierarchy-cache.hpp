@@ -0,0 +1,144 @@
+// ========================================================================== //
+// File : hierarchy-cache.hpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#pragma once
+#ifndef AURACORE_ENV_HIERARCHY_CACHE
+#define AURACORE_ENV_HIERARCHY_CACHE
+// Internal includes.
+#include <Aura/Core/Environment/hierarchy.hpp>
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <vector>
+
+/// <summary>
+/// Aura main namespace.
+/// </summary>
+namespace Aura
+{
+	/// <summary>
+	/// Aura core environment namespace.
+	/// </summary>
+	namespace Core
+	{
+		/// <summary>
+		/// On-disk cache of the two level bottom level hierarchies. Each mesh
+		/// hierarchy is stored in its own file, named by a hash of the mesh
+		/// vertices, its primitives indices and the builder version. Bottom
+		/// levels live in object space, so equal meshes share the same file
+		/// across runs and moving them never misses.
+		/// Misses are written out on a background thread, which also keeps
+		/// the directory under a size cap by removing the least recently used
+		/// files.
+		/// </summary>
+		class HierarchyCache
+		{
+			public:
+			// Builder version, must change whenever the build output changes.
+			static constexpr std::uint32_t version { 2U };
+			// File header tag.
+			static constexpr std::uint32_t magic { 0x48565241U };
+			// Largest total size of the cache files, in bytes.
+			static constexpr std::uintmax_t max_size { 64U << 20U };
+			// Cache directory, empty disables the cache.
+			std::filesystem::path directory {};
+			// Builds found on disk.
+			std::uint32_t hits { 0U };
+			// Builds not found on disk, or found invalid.
+			std::uint32_t misses { 0U };
+			private:
+			/// <summary>
+			/// Built hierarchy waiting to be written.
+			/// </summary>
+			struct Pending
+			{
+				std::uint64_t key;
+				std::uint32_t n_bounds;
+				Hierarchy hierarchy;
+			};
+			// Misses since the last flush.
+			std::vector<Pending> pending {};
+			// Last background write, each one waits for the one before.
+			std::future<void> writing {};
+
+			// ------------------------------------------------------------------ //
+			// Set-up and tear-down.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Creates an empty cache, disabled until given a directory.
+			/// </summary>
+			HierarchyCache() = default;
+			/// <summary>
+			/// Waits for the background writes.
+			/// </summary>
+			~HierarchyCache() noexcept;
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Loads the mesh hierarchy of the given key from the cache, or
+			/// builds it over the given object space boxes on a miss. Misses
+			/// are only written on the next flush. Returns whenever it was a
+			/// hit.
+			/// </summary>
+			bool build(std::uint64_t const key, std::vector<Bounds> const & bounds, Hierarchy & hierarchy);
+			/// <summary>
+			/// Writes the misses since the last flush on a background thread,
+			/// then evicts the oldest files past the size cap.
+			/// </summary>
+			void flush();
+			/// <summary>
+			/// Waits for the background writes.
+			/// </summary>
+			void wait() const;
+			/// <summary>
+			/// Hash of the mesh primitives, the vertices they index, their
+			/// indices from the first mesh vertex and the builder version.
+			/// </summary>
+			static std::uint64_t key(std::vector<std::uint32_t> const & mesh,
+				std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices) noexcept;
+			private:
+			/// <summary>
+			/// Cache file header.
+			/// </summary>
+			struct Header
+			{
+				std::uint32_t magic;
+				std::uint32_t version;
+				std::uint64_t key;
+				std::uint32_t n_bounds;
+				std::uint32_t n_nodes;
+				std::uint32_t n_references;
+				std::uint32_t reserved;
+			};
+			/// <summary>
+			/// Cache file of the given key.
+			/// </summary>
+			static std::filesystem::path file(std::filesystem::path const & directory, std::uint64_t const key);
+			/// <summary>
+			/// Reads a cached hierarchy, checking it matches the given key and
+			/// number of boxes.
+			/// </summary>
+			bool load(std::uint64_t const key, std::uint32_t const n_bounds, Hierarchy & hierarchy) const;
+			/// <summary>
+			/// Writes a hierarchy to the cache. Failures only cost a rebuild on
+			/// the next run, so they are ignored.
+			/// </summary>
+			static void store(std::filesystem::path const & directory, Pending const & entry);
+			/// <summary>
+			/// Removes the least recently used cache files until they fit
+			/// under the size cap. Failures are ignored, like on store.
+			/// </summary>
+			static void evict(std::filesystem::path const & directory);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,409 @@
+// ========================================================================== //
+// File : hierarchy.hpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#pragma once
+#ifndef AURACORE_ENV_HIERARCHY
+#define AURACORE_ENV_HIERARCHY
+// Internal includes.
+#include <Aura/Core/settings.hpp>
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+/// <summary>
+/// Aura main namespace.
+/// </summary>
+namespace Aura
+{
+	/// <summary>
+	/// Aura core environment namespace.
+	/// </summary>
+	namespace Core
+	{
+#	pragma warning(disable : 4324)
+		/// <summary>
+		/// Axis aligned bounding box. Starts empty (inverted) and grows with
+		/// each added point or box.
+		/// </summary>
+		struct Bounds
+		{
+			// Box minimum corner.
+			glm::vec3 min { std::numeric_limits<float>::max() };
+			// Box maximum corner.
+			glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+			/// <summary>
+			/// Grows the box to contain the given point.
+			/// </summary>
+			void grow(glm::vec3 const & point) noexcept
+			{
+				min = glm::min(min, point);
+				max = glm::max(max, point);
+			}
+			/// <summary>
+			/// Grows the box to contain the given box.
+			/// </summary>
+			void grow(Bounds const & bounds) noexcept
+			{
+				min = glm::min(min, bounds.min);
+				max = glm::max(max, bounds.max);
+			}
+			/// <summary>
+			/// Checks if the box contains anything.
+			/// </summary>
+			bool valid() const noexcept
+			{
+				return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+			}
+			/// <summary>
+			/// Box centre point.
+			/// </summary>
+			glm::vec3 centroid() const noexcept
+			{
+				return (min + max) * 0.5f;
+			}
+			/// <summary>
+			/// Box surface area, 0 if the box is empty.
+			/// </summary>
+			float area() const noexcept
+			{
+				if(!valid()) { return 0.0f; }
+				glm::vec3 const e { max - min };
+				return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+			}
+		};
+		/// <summary>
+		/// Hierarchy node, as read by the shaders. Interior nodes store both
+		/// children indices, leaves store the leaf flag and the first reference
+		/// on the left and the number of references on the right.
+		/// </summary>
+		struct Node
+		{
+			// Node box minimum corner.
+			glm::vec3 min { std::numeric_limits<float>::max() };
+			// Left child index or flagged first reference.
+			std::uint32_t left { 0U };
+			// Node box maximum corner.
+			glm::vec3 max { std::numeric_limits<float>::lowest() };
+			// Right child index or reference count.
+			std::uint32_t right { 0U };
+		};
+		/// <summary>
+		/// Entity instance, as read by the shaders. Rays are moved into the
+		/// entity object space before walking its bottom level hierarchy.
+		/// </summary>
+		struct Instance
+		{
+			// Inverse of the full entity transform.
+			glm::mat4 world_to_object { glm::identity<glm::mat4>() };
+			// Root node of the entity bottom level hierarchy.
+			alignas(sizeof(glm::vec4)) std::uint32_t root { 0U };
+			// Entity material, replaces the material of the instanced primitives.
+			std::uint32_t material_idx { 0U };
+		};
+		/// <summary>
+		/// Wide hierarchy node, as read by the shaders. Holds the boxes of up
+		/// to four children, quantized to 8 bits per plane on a grid over the
+		/// node box. Each grid axis has a power of two step, stored as a
+		/// biased float exponent.
+		/// Interior children store their node index, leaf children the leaf
+		/// flag and their first reference, plus the reference count in the
+		/// counts byte of their slot.
+		/// </summary>
+		struct WideNode
+		{
+			// Grid origin, the node box minimum corner.
+			glm::vec3 origin { 0.0f };
+			// Grid step exponents, one byte per axis.
+			std::uint32_t exponents { 0U };
+			// Child lower and upper x planes, then lower and upper y planes,
+			// one byte per child.
+			glm::uvec4 bounds_xy { 0U };
+			// Child lower and upper z planes and leaf reference counts, one
+			// byte per child. The last entry is unused.
+			glm::uvec4 bounds_z { 0U };
+			// Child node indices or flagged first references.
+			glm::uvec4 children { 0xFFFFFFFFU };
+		};
+#	pragma warning(default : 4324)
+		/// <summary>
+		/// Primitive triangle, used to clip references on spatial splits.
+		/// Other primitive types are left invalid and clipped by their box.
+		/// </summary>
+		struct Triangle
+		{
+			// Triangle vertices.
+			glm::vec3 v0 { 0.0f };
+			glm::vec3 v1 { 0.0f };
+			glm::vec3 v2 { 0.0f };
+			// Whenever the primitive is a triangle.
+			bool valid { false };
+		};
+		/// <summary>
+		/// Bounding volume hierarchy over a set of primitive boxes. Built top
+		/// down with a binned surface area heuristic. Nodes are stored in
+		/// pre-order, so children always follow their parent.
+		/// </summary>
+		class Hierarchy
+		{
+			public:
+			// Flag set on the left index of leaf nodes.
+			static constexpr std::uint32_t leaf_flag { 0x80000000U };
+			// Leaves with up to this many references are not forced to split.
+			static constexpr std::uint32_t max_leaf_size { 4U };
+			// Maximum depth, matches the shader traversal stack.
+			static constexpr std::uint32_t max_depth { 64U };
+			// Number of bins used per axis on each split evaluation.
+			static constexpr std::uint32_t n_bins { 12U };
+			// Relative cost of a node box test.
+			static constexpr float traversal_cost { 1.0f };
+			// Relative cost of a primitive intersection test.
+			static constexpr float intersection_cost { 1.0f };
+			// Largest extra references fraction spatial splits may add.
+			static constexpr float max_spatial_budget { 1.0f };
+			// Children overlap, relative to the root area, past which spatial
+			// splits are tried.
+			static constexpr float spatial_overlap { 0.00001f };
+			// Morton code bits per axis, used by the linear build.
+			static constexpr std::uint32_t morton_bits { 10U };
+			// Morton code of empty primitives, sorts them last.
+			static constexpr std::uint32_t empty_code { 0x3FFFFFFFU };
+			// Hierarchy nodes, root first.
+			std::vector<Node> nodes {};
+			// Primitive indices, leaves point to ranges of this list.
+			std::vector<std::uint32_t> references {};
+			// Cost of the last full build.
+			float build_cost { 0.0f };
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Rebuilds the hierarchy over the given primitive boxes. Each box
+			/// index is the primitive index, empty boxes are left out.
+			/// </summary>
+			void build(std::vector<Bounds> const & bounds);
+			/// <summary>
+			/// Rebuilds the hierarchy as a linear hierarchy over the Morton
+			/// codes of the box centroids. Follows the device build step by
+			/// step, so both produce the same layout: internal nodes first,
+			/// then one leaf per primitive in Morton order.
+			/// </summary>
+			void buildLinear(std::vector<Bounds> const & bounds);
+			/// <summary>
+			/// Rebuilds the hierarchy with spatial splits. Where object split
+			/// children overlap, references may also be split by a plane and
+			/// clipped to each side, up to the budget fraction of extra
+			/// references. Leaves may then share primitives.
+			/// </summary>
+			void buildSpatial(std::vector<Bounds> const & bounds, std::vector<Triangle> const & triangles,
+				float const budget);
+			/// <summary>
+			/// Fits every node box to the given primitive boxes, keeping the
+			/// topology. Only valid for a build, where children always follow
+			/// their parent. Returns the cost ratio against the last build.
+			/// </summary>
+			float refit(std::vector<Bounds> const & bounds);
+			/// <summary>
+			/// Surface area heuristic cost of the hierarchy, relative to the
+			/// root area.
+			/// </summary>
+			float cost() const noexcept;
+			/// <summary>
+			/// Calculates the world space box of a primitive, applying its
+			/// transform the same way the vertex stage does.
+			/// </summary>
+			static Bounds primitiveBounds(Primitive const & primitive,
+				std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms);
+			/// <summary>
+			/// Calculates the object space box of a primitive, ignoring its
+			/// transform.
+			/// </summary>
+			static Bounds primitiveBounds(Primitive const & primitive,
+				std::vector<Vertex> const & vertices);
+			/// <summary>
+			/// World space triangle of a primitive, invalid for other types.
+			/// </summary>
+			static Triangle primitiveTriangle(Primitive const & primitive,
+				std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms);
+			private:
+			/// <summary>
+			/// Searches the best binned split of the list range. Returns
+			/// whenever a valid split was found and updates the axis, the last
+			/// left bin and the split cost.
+			/// </summary>
+			static bool findSplit(std::vector<std::uint32_t> const & list,
+				std::vector<glm::vec3> const & centroids, std::vector<Bounds> const & bounds,
+				Bounds const & centroid_bounds, float const parent_area,
+				std::uint32_t const first, std::uint32_t const count,
+				std::uint32_t & axis, std::uint32_t & split, float & cost);
+			/// <summary>
+			/// Searches the best binned spatial split of the given boxes, each
+			/// clipped to every bin it spans, adding at most the remaining
+			/// references. Returns whenever a valid split was found and
+			/// updates the axis, the plane and the split cost.
+			/// </summary>
+			static bool findSpatialSplit(std::vector<Bounds> const & boxes,
+				std::vector<std::uint32_t> const & primitives, std::vector<Triangle> const & triangles,
+				Bounds const & node_bounds, std::uint32_t const remaining,
+				std::uint32_t & axis, float & plane, float & cost);
+			/// <summary>
+			/// Clips a reference box to the slab between both planes along the
+			/// axis, tightened to the triangle part inside the slab.
+			/// </summary>
+			static Bounds clip(Bounds const & box, Triangle const & triangle,
+				std::uint32_t const axis, float const lo, float const hi) noexcept;
+			/// <summary>
+			/// Calculates the bin of a centroid along the given axis.
+			/// </summary>
+			static std::uint32_t bin(glm::vec3 const & centroid, Bounds const & centroid_bounds,
+				std::uint32_t const axis) noexcept;
+			/// <summary>
+			/// Spreads the lower 10 bits so there are two zero bits between
+			/// each.
+			/// </summary>
+			static std::uint32_t expand(std::uint32_t v) noexcept;
+		};
+		/// <summary>
+		/// Wide hierarchy, collapsed from a binary hierarchy by pulling up the
+		/// largest children of each node until it has four. Shares the binary
+		/// hierarchy references.
+		/// </summary>
+		class WideHierarchy
+		{
+			public:
+			// Children per node.
+			static constexpr std::uint32_t width { 4U };
+			// Marks unused child slots.
+			static constexpr std::uint32_t empty_child { 0xFFFFFFFFU };
+			// Largest leaf the counts byte can hold, bigger leaves are split
+			// across extra nodes.
+			static constexpr std::uint32_t max_leaf_references { 0xFFU };
+			// Hierarchy nodes, root first.
+			std::vector<WideNode> nodes {};
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Rebuilds the wide hierarchy from a binary hierarchy.
+			/// </summary>
+			void build(Hierarchy const & binary);
+			private:
+			/// <summary>
+			/// Child of a wide node, either a binary node or a range of
+			/// references.
+			/// </summary>
+			struct Child
+			{
+				Bounds box;
+				// Binary interior node, or empty_child for a reference range.
+				std::uint32_t node;
+				std::uint32_t first;
+				std::uint32_t count;
+			};
+			/// <summary>
+			/// Opens an interior child into the children of its wide node.
+			/// </summary>
+			static std::vector<Child> open(Hierarchy const & binary, Child const & parent);
+			/// <summary>
+			/// Binary node as a child, leaves become reference ranges.
+			/// </summary>
+			static Child child(Hierarchy const & binary, std::uint32_t const node) noexcept;
+			/// <summary>
+			/// Checks if a child needs its own wide node.
+			/// </summary>
+			static bool interior(Child const & child) noexcept
+			{
+				return child.node != empty_child || child.count > max_leaf_references;
+			}
+			/// <summary>
+			/// Stores the children quantized boxes on the node, creating wide
+			/// nodes for the interior children. Returns the new nodes paired
+			/// with their children.
+			/// </summary>
+			std::vector<std::pair<std::uint32_t, Child>> encode(std::uint32_t const node,
+				std::vector<Child> const & children);
+		};
+		// On-disk hierarchy cache.
+		class HierarchyCache;
+		/// <summary>
+		/// Two level hierarchy. Every entity owns a bottom level hierarchy
+		/// over its primitives in object space, and a top level hierarchy is
+		/// built over the transformed entity boxes. Transform changes only
+		/// rebuild the top level.
+		/// All levels are flattened into a single node and reference list.
+		/// The top level sits in a fixed size region at the start of both,
+		/// so it can be updated without touching the bottom levels.
+		/// </summary>
+		class TwoLevelHierarchy
+		{
+			public:
+			// Nodes reserved for the top level.
+			static constexpr std::uint32_t top_nodes {
+				2U * static_cast<std::uint32_t>(EnvLimits::limit_entities) };
+			// References reserved for the top level.
+			static constexpr std::uint32_t top_references {
+				static_cast<std::uint32_t>(EnvLimits::limit_entities) };
+			// Flattened nodes, top level region first.
+			std::vector<Node> nodes {};
+			// Flattened references, top level entries are entity indices and
+			// bottom level entries are primitive indices.
+			std::vector<std::uint32_t> references {};
+			// Entity instances, indexed by entity.
+			std::vector<Instance> instances {};
+			private:
+			// Top level hierarchy.
+			Hierarchy top {};
+			// Entity bottom level hierarchies.
+			std::vector<Hierarchy> bottom {};
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Rebuilds every entity bottom level hierarchy and flattens them
+			/// after the top level region. Bottom levels are looked up in the
+			/// cache first. Instances share the bottom level of their source.
+			/// The top level must be rebuilt after.
+			/// </summary>
+			void buildBottom(std::vector<Entity> const & entities,
+				std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices,
+				HierarchyCache & cache);
+			/// <summary>
+			/// Rebuilds the instances and the top level hierarchy over the
+			/// current bottom levels.
+			/// </summary>
+			void buildTop(std::vector<Entity> const & entities, std::vector<Transform> const & transforms);
+			/// <summary>
+			/// Full entity transform, applied to every primitive type alike.
+			/// </summary>
+			static glm::mat4 entityTransform(Transform const & transform) noexcept
+			{
+				return transform.translation * transform.rotation * transform.scaling;
+			}
+			private:
+			/// <summary>
+			/// Entity owning the primitives of the given entity.
+			/// </summary>
+			static std::size_t mesh(std::vector<Entity> const & entities, std::size_t const e) noexcept
+			{
+				return entities[e].source_idx == Entity::no_source ? e : entities[e].source_idx;
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,91 @@
+// ========================================================================== //
+// File : lights.hpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#pragma once
+#ifndef AURACORE_ENV_LIGHTS
+#define AURACORE_ENV_LIGHTS
+// Internal includes.
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <cstdint>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+/// <summary>
+/// Aura main namespace.
+/// </summary>
+namespace Aura
+{
+	/// <summary>
+	/// Aura core environment namespace.
+	/// </summary>
+	namespace Core
+	{
+		/// <summary>
+		/// Light list entry, an emissive surface in world space, as read by
+		/// the shaders. Lights are either spheres or triangles.
+		/// </summary>
+		struct LightRecord
+		{
+			// First vertex, or sphere center.
+			glm::vec3 v0 { 0.0f };
+			// Primitive type, sphere or triangle.
+			Primitive::Types type { Primitive::Types::Empty };
+			// Second vertex.
+			glm::vec3 v1 { 0.0f };
+			// Sphere radius.
+			float radius { 0.0f };
+			// Third vertex.
+			glm::vec3 v2 { 0.0f };
+			// Index of light material.
+			std::uint32_t material_idx { 0U };
+			// Surface area.
+			float area { 0.0f };
+			// Area of this light and all lights before it, over the total.
+			float cdf { 0.0f };
+			// Padding to the shader stride.
+			std::uint32_t padding[2U] { 0U, 0U };
+		};
+		/// <summary>
+		/// Emissive primitives of the scene, sampled by next event estimation.
+		/// Lights are picked by their area, so every point on them is as
+		/// likely. Cuboids are split into their face triangles.
+		/// </summary>
+		class LightList
+		{
+			public:
+			// Lights, in world space.
+			std::vector<LightRecord> records {};
+			// Total area of the lights.
+			float area { 0.0f };
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Rebuilds the lights from the emissive primitives of every entity,
+			/// moved to world space by their transform. Instances add the lights
+			/// of their source, with their own transform and material. Throws past
+			/// the lights limit, as the shaders weight every emissive hit as a
+			/// light of the list.
+			/// </summary>
+			void build(std::vector<Entity> const & entities, std::vector<Primitive> const & primitives,
+				std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms,
+				std::vector<Material> const & materials);
+			private:
+			/// <summary>
+			/// Adds a triangle light, unless it has no area.
+			/// </summary>
+			void addTriangle(glm::vec3 const & v0, glm::vec3 const & v1, glm::vec3 const & v2,
+				std::uint32_t const material_idx);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,137 @@
+// ========================================================================== //
+// File : streams.hpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#pragma once
+#ifndef AURACORE_ENV_STREAMS
+#define AURACORE_ENV_STREAMS
+// Internal includes.
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+/// <summary>
+/// Aura main namespace.
+/// </summary>
+namespace Aura
+{
+	/// <summary>
+	/// Aura core environment namespace.
+	/// </summary>
+	namespace Core
+	{
+		/// <summary>
+		/// Sphere stream entry, as read by the shaders.
+		/// </summary>
+		struct SphereRecord
+		{
+			// Sphere center.
+			glm::vec3 center { 0.0f };
+			// Sphere radius.
+			float radius { 0.0f };
+			// Index of primitive material.
+			std::uint32_t material_idx { 0U };
+			// Padding to the shader stride.
+			std::uint32_t padding[3U] { 0U, 0U, 0U };
+		};
+		/// <summary>
+		/// Cuboid stream entry, as read by the shaders. Cuboids are oriented
+		/// boxes, tested in their own frame after moving the ray.
+		/// </summary>
+		struct CuboidRecord
+		{
+			// World to box frame transform rows.
+			glm::vec4 to_local[3U] {
+				glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+				glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+				glm::vec4(0.0f, 0.0f, 1.0f, 0.0f) };
+			// Cuboid minimum corner, in its frame.
+			glm::vec3 min { 0.0f };
+			// Index of primitive material.
+			std::uint32_t material_idx { 0U };
+			// Cuboid maximum corner, in its frame.
+			glm::vec3 max { 0.0f };
+			// Padding to the shader stride.
+			std::uint32_t padding { 0U };
+		};
+		/// <summary>
+		/// Triangle stream entry, with its vertices inlined and its normal
+		/// precomputed, as read by the shaders. Vertices are kept as they are,
+		/// rather than as edges, so shared edges stay watertight.
+		/// </summary>
+		struct TriangleRecord
+		{
+			// First vertex.
+			glm::vec3 v0 { 0.0f };
+			// Index of primitive material.
+			std::uint32_t material_idx { 0U };
+			// Second vertex.
+			glm::vec3 v1 { 0.0f };
+			// Padding to the shader alignment.
+			std::uint32_t padding0 { 0U };
+			// Third vertex.
+			glm::vec3 v2 { 0.0f };
+			// Padding to the shader alignment.
+			std::uint32_t padding1 { 0U };
+			// Geometric normal, not normalised.
+			glm::vec3 normal { 0.0f };
+			// Padding to the shader stride.
+			std::uint32_t padding2 { 0U };
+		};
+		/// <summary>
+		/// Primitives split into tightly packed per type streams. Primitives
+		/// and vertices stay the authoring format, each primitive is given a
+		/// slot in the stream of its type and referenced by its type and slot,
+		/// so the shaders never go through the vertices.
+		/// </summary>
+		class PrimitiveStreams
+		{
+			public:
+			// Type bits position in a stream reference.
+			static constexpr std::uint32_t type_shift { 30U };
+			// Slot bits in a stream reference.
+			static constexpr std::uint32_t slot_mask { (1U << type_shift) - 1U };
+			// Sphere stream.
+			std::vector<SphereRecord> spheres {};
+			// Cuboid stream.
+			std::vector<CuboidRecord> cuboids {};
+			// Triangle stream.
+			std::vector<TriangleRecord> triangles {};
+			// Stream reference of each primitive. Empty primitives are left as
+			// empty references.
+			std::vector<std::uint32_t> references {};
+
+			// ------------------------------------------------------------------ //
+			// Construction.
+			// ------------------------------------------------------------------ //
+			public:
+			/// <summary>
+			/// Rebuilds the streams from the primitives, without transforms.
+			/// Primitives keep their order inside each stream.
+			/// </summary>
+			void build(std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices);
+			/// <summary>
+			/// Copies the given primitive indices as stream references. Entries
+			/// before first are left as they are.
+			/// </summary>
+			std::vector<std::uint32_t> encode(std::vector<std::uint32_t> const & indices,
+				std::size_t const first = 0U) const;
+			/// <summary>
+			/// Stream reference of a slot in the stream of the given type.
+			/// </summary>
+			static constexpr std::uint32_t reference(Primitive::Types const type, std::uint32_t const slot) noexcept
+			{
+				return static_cast<std::uint32_t>(type) << type_shift | slot;
+			}
+		};
+	}
+}
+
+#endif
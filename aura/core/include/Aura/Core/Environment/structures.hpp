@@ -98,8 +98,13 @@ namespace Aura
 			std::uint32_t transform_idx { 0U };
 			// Entity Material.
 			std::uint32_t material_idx { 0U };
-			// Entity primitive list.
-			std::vector<Primitive *> primitives {};
+			// Entity primitive list, as indices into the scene primitives.
+			std::vector<std::uint32_t> primitives {};
+			// Entity whose primitives are instanced, no_source when the entity
+			// owns its primitives.
+			std::uint32_t source_idx { no_source };
+			// Source index of entities owning their primitives.
+			static constexpr std::uint32_t no_source { 0xFFFFFFFFU };
 		};
 		/// <summary>
 		/// Physical representation of a point of view.
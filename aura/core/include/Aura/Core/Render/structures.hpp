@@ -43,27 +43,49 @@ namespace Aura
 			std::uint32_t n_samples = { 0U };
 			// Number of primitives in scene.
 			std::uint32_t n_primitives = { 0U };
-			// Image width.
+			// Traced tile width, the image width if not tiled.
 			std::uint32_t width = { 0U };
-			// Image height.
+			// Traced tile height, the image height if not tiled.
 			std::uint32_t height = { 0U };
+			// Scene traversal mode.
+			std::uint32_t traversal = { 0U };
+			// Number of primitives in each type stream.
+			std::uint32_t n_spheres = { 0U };
+			std::uint32_t n_cuboids = { 0U };
+			std::uint32_t n_triangles = { 0U };
+			// Samples traced together, each in its own rays state slice.
+			std::uint32_t batch = { 1U };
+			// Bounces before Russian roulette, 0 if disabled.
+			std::uint32_t roulette_depth = { 0U };
+			// Image width.
+			std::uint32_t image_width = { 0U };
+			// Image height.
+			std::uint32_t image_height = { 0U };
+			// Adaptive sampling relative error threshold, 0 if disabled.
+			float adaptive_threshold = { 0.0f };
+			// Samples before adaptive sampling may stop a pixel.
+			std::uint32_t adaptive_min = { 0U };
+			// Whenever diffuse hits sample the lights, 0 if disabled.
+			std::uint32_t next_event = { 0U };
+			// Number of lights in the light list.
+			std::uint32_t n_lights = { 0U };
+			// Total area of the lights.
+			float light_area = { 0.0f };
 		};
 		/// <summary>
-		/// Structure which contains random values supplied by push constants to
-		/// the shader.
-		/// </summary>
-		struct RandomSeed
-		{
-			glm::vec2 seed {};
-		};
-		/// <summary>
-		/// Structure which contains random values supplied by push constants to
-		/// the shader.
+		/// Sample being traced, supplied by push constants to the shaders. The
+		/// shaders hash it with each ray and bounce into their own random
+		/// numbers.
 		/// </summary>
-		struct RandomPointInCircleAndSeed
+		struct SampleSeed
 		{
-			glm::vec3 point {};
-			float seed {};
+			// Frame being rendered.
+			std::uint32_t frame { 0U };
+			// Sample submission within the frame.
+			std::uint32_t sample { 0U };
+			// Whenever rays are jittered within the lens and pixel, 0 when
+			// anti-aliasing is off.
+			std::uint32_t jitter { 0U };
 		};
 		/// <summary>
 		/// Representation of camera used within the shader to determine the rays
@@ -97,10 +119,16 @@ namespace Aura
 			alignas(sizeof(glm::vec4)) glm::vec3 origin { 0.0f, 0.0f, 0.0f };
 			// Ray direction.
 			alignas(sizeof(glm::vec4)) glm::vec3 direction { 0.0f, 0.0f, 1.0f };
+			// Solid angle density the direction was sampled with, 0 unless it
+			// comes from a diffuse bounce that also sampled the lights.
+			float pdf { 0.0f };
 			// Ray colour strength.
 			glm::vec3 albedo { 1.0f, 1.0f, 1.0f };
 			// If ray has not missed.
 			std::uint32_t missed { 0U };
+			// Path sample gathered so far, with the light of its shadow rays.
+			// Added to the pixel once, when the path ends.
+			alignas(sizeof(glm::vec4)) glm::vec4 colour { 0.0f, 0.0f, 0.0f, 0.0f };
 		};
 		/// <summary>
 		/// Ray hit description.
@@ -119,6 +147,39 @@ namespace Aura
 			alignas(sizeof(glm::vec4)) std::uint32_t inside { 0U };
 		};
 		/// <summary>
+		/// Shadow ray towards a light point, traced after the bounce that
+		/// sampled it.
+		/// </summary>
+		struct ShadowRay
+		{
+			// Ray origin.
+			glm::vec3 origin { 0.0f, 0.0f, 0.0f };
+			// Distance to the light point.
+			float reach { 0.0f };
+			// Ray direction.
+			glm::vec3 direction { 0.0f, 0.0f, 1.0f };
+			// If the ray is waiting to be traced.
+			std::uint32_t live { 0U };
+			// Light carried to the pixel if nothing blocks the ray.
+			glm::vec3 radiance { 0.0f, 0.0f, 0.0f };
+			// Padding to the shader stride.
+			std::uint32_t padding { 0U };
+		};
+		/// <summary>
+		/// Ray queue, indirect dispatch group counts followed by the number
+		/// of queued rays. Starts empty.
+		/// </summary>
+		struct RayQueue
+		{
+			// Work groups along each axis. Longer queues take rows of groups
+			// along y.
+			std::uint32_t x { 0U };
+			std::uint32_t y { 1U };
+			std::uint32_t z { 1U };
+			// Queued rays.
+			std::uint32_t count { 0U };
+		};
+		/// <summary>
 		/// Pixel state.
 		/// </summary>
 		struct Pixel
@@ -105,6 +105,14 @@ namespace Aura::Core
 		/// </summary>
 		bool newEntity(std::uint32_t const material_idx, std::uint32_t & idx);
 		/// <summary>
+		/// Creates an entity instancing the primitives of the source entity,
+		/// with its own transform and material, and updates given index. No
+		/// geometry is copied, so scenes with instances are always drawn by
+		/// the two level traversal, which moves rays into each instance space.
+		/// Returns whenever a new instance was created.
+		/// </summary>
+		bool newInstance(std::uint32_t const source_idx, std::uint32_t const material_idx, std::uint32_t & idx);
+		/// <summary>
 		/// Adds a the given primitive to the scene. The primitive's material
 		/// and transform indices are ignored and it is moved into the scene. 
 		/// </summary>
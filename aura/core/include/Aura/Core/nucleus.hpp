@@ -121,7 +121,8 @@ namespace Aura::Core
 		/// </summary>
 		void renderFrame();
 		/// <summary>
-		/// Schedule a rendering job, wait for it to stop and outputs time.
+		/// Schedule a rendering job and outputs its time, which covers the
+		/// wait for the previous frame.
 		/// </summary>
 		void renderWithTime();
 
@@ -170,6 +171,23 @@ namespace Aura::Core
 		/// </summary>
 		std::vector<std::pair<vk::PhysicalDevice, bool>> const & getDevices() const noexcept
 		{ return render.getPhysicalDevices(); }
+		/// <summary>
+		/// Hierarchy builds found in the cache since the renderer creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheHits() const noexcept
+		{ return render.getHierarchyCacheHits(); }
+		/// <summary>
+		/// Hierarchy builds not found in the cache since the renderer
+		/// creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheMisses() const noexcept
+		{ return render.getHierarchyCacheMisses(); }
+		/// <summary>
+		/// Mean luminance of the accumulated image, over the pixels with any
+		/// sample. Waits for the renderer to finish its frames first.
+		/// </summary>
+		float getMeanLuminance() const
+		{ return render.getMeanLuminance(); }
 	};
 }
 
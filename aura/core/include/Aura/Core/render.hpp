@@ -10,6 +10,7 @@
 #include <Aura/Core/settings.hpp>
 // Standard includes.
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <future>
 #include <thread>
@@ -22,7 +23,7 @@
 #include <vulkan/vulkan.hpp>
 #pragma warning(default : 26495)
 #pragma warning(disable : 26812)
-#include <glm/vec3.hpp>
+#include <glm/vec2.hpp>
 #pragma warning(default : 26812)
 
 namespace Aura::Core
@@ -31,9 +32,6 @@ namespace Aura::Core
 	class Nucleus;
 	// Ray tracing framework.
 	class RayTracer;
-	// Push random values.
-	struct RandomSeed;
-	struct RandomPointInCircleAndSeed;
 	/// <summary>
 	/// Englobes the queue and its respective family index.
 	/// </summary>
@@ -56,6 +54,25 @@ namespace Aura::Core
 		vk::Semaphore c_semaphore {};
 	};
 	/// <summary>
+	/// Scene upload submitted ahead of the frame that waits on it, with the
+	/// work the frame does on the uploaded scene info.
+	/// </summary>
+	struct SceneUpload
+	{
+		// Whenever an upload was submitted and no frame waits on it yet.
+		bool submitted { false };
+		// Whenever the scene or materials changed.
+		bool update { false };
+		// Whenever the geometry must be transformed, and the hierarchy then
+		// built on the device.
+		bool vertex_update { false };
+		bool build_update { false };
+		// The same for the updates of the last upload, which the next one
+		// replays to the other scene info copy.
+		bool replay_vertex { false };
+		bool replay_build { false };
+	};
+	/// <summary>
 	/// Program render and render cycle. Uses a vulkan compute ray tracer as a
 	/// render. Takes care of vulkan instance, debug and surface creation, as
 	/// well as, device selection, commands and sync.
@@ -87,10 +104,26 @@ namespace Aura::Core
 		std::array<vk::PipelineStageFlags, 4> const stage_flags;
 		// Dispatch structures for each thread.
 		std::vector<DispatchJobs> dispatch_jobs;
+		// Scene upload, on the transfer queue, one per scene info copy. The
+		// upload of a copy may still run while the other is recorded.
+		std::array<DispatchJobs, 2U> upload_jobs;
+		// Scene info release to the transfer queue, on the compute queue, one
+		// per scene info copy. Only used if both queues are of different
+		// families.
+		std::array<DispatchJobs, 2U> release_jobs;
+		// Semaphores the first submission waits on, per scene info copy, the
+		// frame acquisition and the upload of the copy, and the stages they
+		// wait at.
+		std::array<std::array<vk::Semaphore, 2U>, 2U> first_waits {};
+		std::array<vk::PipelineStageFlags, 2U> const first_stages;
+		// Scene upload of the next frame.
+		SceneUpload scene_upload;
 		// Render fence.
 		vk::Fence main_fence;
 		// Frame acquisition semaphore.
 		vk::Semaphore acquisition_semaphore {};
+		// Frames dispatched, seeds the random numbers of the shaders.
+		std::uint32_t frame_count { 0U };
 
 		// ------------------------------------------------------------------ //
 		// Set-up and tear-down.
@@ -124,15 +157,33 @@ namespace Aura::Core
 		bool waitForMainFence(std::uint64_t timeout) const;
 		private:
 		/// <summary>
-		/// Checks for any updates in the environment and clones the new states
-		/// to the GPU. Waits for any required work to finish.
+		/// Stages any scene and materials updates and submits their upload,
+		/// to the scene info copy the previous frame does not read. Sets the
+		/// scene upload of the next frame. May run while the previous frame
+		/// renders.
+		/// </summary>
+		void updateScene();
+		/// <summary>
+		/// Checks for any updates in the rest of the environment and clones
+		/// the new states to the GPU. Waits for any required work to finish.
+		/// The previous frame must be finished. Returns whenever the camera or
+		/// render settings changed.
 		/// </summary>
 		bool updateEnvironment(std::uint32_t const & frame_idx) const;
 		/// <summary>
+		/// Submits the staged scene info updates, and the replay of the last
+		/// upload, to the transfer queue, if any, handing the written buffers
+		/// over from the compute queue and back. The upload runs while the
+		/// previous frame renders. Returns whenever the next frame must wait
+		/// on it.
+		/// </summary>
+		bool submitSceneUpload() const;
+		/// <summary>
 		/// Records and submits all necessary commands to render the image in
-		/// the current settings.
+		/// the current settings, after the scene upload if there is one.
 		/// </summary>
-		void dispatchFrameJobs(std::uint32_t const & frame_idx, bool const & update) const;
+		void dispatchFrameJobs(std::uint32_t const & frame_idx, bool const & update,
+			bool const & vertex_update, bool const & build_update, bool const & upload) const;
 
 		// ------------------------------------------------------------------ //
 		// Command recording and submission schedule.
@@ -140,22 +191,34 @@ namespace Aura::Core
 		private:
 		/// <summary>
 		/// Builds the entire submit info as necessary for queue submission.
+		/// The first submission waits on the scene upload, if there is one.
 		/// </summary>
-		void dispatchSubmitInfo(const std::size_t n_submits, std::vector<vk::SubmitInfo> & submits) const;
+		void dispatchSubmitInfo(const std::size_t n_submits, bool const upload,
+			std::vector<vk::SubmitInfo> & submits) const;
 		/// <summary>
 		/// Records the layout transition to geral to a initial submission.
+		/// Uploaded scene info is acquired first. The vertex stage only runs
+		/// when the scene geometry was uploaded again, followed by the device
+		/// hierarchy build if requested.
 		/// </summary>
-		void recordPreProcess(std::uint32_t const frame_idx, bool const update) const;
+		void recordPreProcess(std::uint32_t const frame_idx, bool const update,
+			bool const vertex_update, bool const build_update, bool const upload) const;
 		/// <summary>
 		/// Records a sample sequence in the buffer associated with the sample
-		/// index. Each sequence includes a ray-generation and x sets of 
-		/// intersect, colour and scatter, in this order, equal to the maximum
-		/// depth.
+		/// index, covering a batch of samples. Each sequence includes a
+		/// ray-generation and x sets of intersect, colour and scatter, in this
+		/// order, equal to the maximum depth. With the megakernel backend,
+		/// where supported, the sequence is a single megakernel operation
+		/// instead, and with the fused backend each set is a single bounce
+		/// operation. Tiles are traced one after the other, when tiled the
+		/// first sample of a tile also clears its pixels and the last one
+		/// writes them to the image.
 		/// </summary>
 		void recordSample(bool const is_random, std::size_t const sample_idx) const;
 		/// <summary>
 		/// Records both the post-process and the layout transition, in this order,
-		/// to the same submission.
+		/// to the same submission. When tiled each tile is already written out by
+		/// its last sample, only the transition is left.
 		/// </summary>
 		void recordPostProcess(std::uint32_t const frame_idx) const;
 		/// <summary>
@@ -168,18 +231,6 @@ namespace Aura::Core
 		/// Ends the command buffer record operation.
 		/// </summary>
 		void endRecord(vk::CommandBuffer const & command) const;
-		/// <summary>
-		/// Randomizes a value limited to a circle with 1 unit radius.
-		/// </summary>
-		glm::vec3 randomInCircle() const;
-		/// <summary>
-		/// Fills structure with sets of random vectors within a circle.
-		/// </summary>
-		void fillRandomsWithinCircle(RandomPointInCircleAndSeed & randoms) const;
-		/// <summary>
-		/// Fills structure with generated values.
-		/// </summary>
-		void fillRandoms(RandomSeed & randoms) const;
 
 		// ------------------------------------------------------------------ //
 		// Vulkan set-up and tear-down related.
@@ -279,6 +330,28 @@ namespace Aura::Core
 		/// used before re-selecting a new device.
 		/// </summary>
 		void tearDownDispatch() noexcept;
+		/// <summary>
+		/// Samples traced together by each sample submission, at least one.
+		/// </summary>
+		std::uint32_t sampleBatch() const noexcept;
+		/// <summary>
+		/// Sample submissions per frame, enough whole batches to cover the
+		/// anti-aliasing samples.
+		/// </summary>
+		std::size_t nSampleJobs() const noexcept;
+		/// <summary>
+		/// Traced tile dimensions, the image dimensions if not tiled. Edge tiles
+		/// may reach past the image.
+		/// </summary>
+		vk::Extent2D tileExtent() const noexcept;
+		/// <summary>
+		/// Tiles covering the image.
+		/// </summary>
+		std::size_t nTiles() const noexcept;
+		/// <summary>
+		/// Image origin of the given tile, tiles are numbered row by row.
+		/// </summary>
+		glm::uvec2 tileOrigin(std::size_t const tile_idx) const noexcept;
 
 		// ------------------------------------------------------------------ //
 		// Vulkan device selection.
@@ -362,6 +435,21 @@ namespace Aura::Core
 		/// </summary>
 		constexpr std::vector<std::pair<vk::PhysicalDevice, bool>> const & getPhysicalDevices() const noexcept
 		{ return physical_devices; }
+		/// <summary>
+		/// Hierarchy builds found in the cache since the framework creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheHits() const noexcept;
+		/// <summary>
+		/// Hierarchy builds not found in the cache since the framework
+		/// creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheMisses() const noexcept;
+		/// <summary>
+		/// Mean luminance of the accumulated image, over the pixels with any
+		/// sample. Waits for the device to finish its frames first. Covers
+		/// the last traced tile, the whole image unless tiled.
+		/// </summary>
+		float getMeanLuminance() const;
 	};
 
 }
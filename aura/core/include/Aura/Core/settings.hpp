@@ -34,6 +34,51 @@ namespace Aura
 			Borderless,
 			Fullscreen
 		};
+		/// <summary>
+		/// Intersection stage traversal types.
+		/// </summary>
+		enum struct TraversalModes : std::uint32_t
+		{
+			// Tests every primitive, kept for comparison.
+			Linear = 0U,
+			// Walks the scene bounding volume hierarchy.
+			Hierarchy = 1U,
+			// Walks a top level hierarchy over entities, then each entity's
+			// own hierarchy in object space.
+			TwoLevel = 2U,
+			// Walks the scene hierarchy collapsed into four wide nodes with
+			// quantized child boxes.
+			Wide = 3U
+		};
+		/// <summary>
+		/// Scene hierarchy builders, used by the hierarchy traversal.
+		/// </summary>
+		enum struct HierarchyBuilders : std::uint32_t
+		{
+			// Binned surface area heuristic, built on the host.
+			Host = 0U,
+			// Linear hierarchy, built on the device after the vertex stage.
+			Device = 1U,
+			// Binned surface area heuristic with spatial splits, built on the
+			// host. Clips long thin triangles that would overlap otherwise.
+			Spatial = 2U
+		};
+		/// <summary>
+		/// Path tracing backends.
+		/// </summary>
+		enum struct RenderBackends : std::uint32_t
+		{
+			// One pipeline per stage, rays and hits go through the rays state
+			// between stages.
+			Wavefront = 0U,
+			// A single pipeline of persistent invocations, each pulling pixels
+			// and tracing their whole path in registers. Needs subgroup ballots
+			// in compute shaders, devices without them use the wavefront one.
+			Megakernel = 1U,
+			// The wavefront pipeline with the intersect and scatter stages of
+			// each bounce fused, so hits are kept in registers.
+			Fused = 2U
+		};
 
 		// ------------------------------------------------------------------ //
 		// Pre-processor definitions and storage limits.
@@ -52,14 +97,18 @@ namespace Aura
 		{
 			// Maximum stored cameras.
 			static constexpr std::size_t limit_cameras { 10U };
-			// Maximum stored transforms and entities.
-			static constexpr std::size_t limit_entities { 10U };
+			// Maximum stored transforms and entities. Instances are entities
+			// too, so this also bounds mesh instancing.
+			static constexpr std::size_t limit_entities { 128U };
 			// Maximum stored transforms.
 			static constexpr std::size_t limit_primitives { 2000U };
 			// Maximum stored materials.
 			static constexpr std::size_t limit_materials { 10U };
 			// Maximum stored vertices.
 			static constexpr std::size_t limit_vertices { 4000U };
+			// Maximum emissive surfaces sampled by next event estimation.
+			// Emissive cuboids take one per face triangle.
+			static constexpr std::size_t limit_lights { 12U * limit_primitives };
 		};
 
 		// ------------------------------------------------------------------ //
@@ -77,6 +126,19 @@ namespace Aura
 			static constexpr bool time_to_file { true };
 			// When on it splits all buffers memories to separate structures.
 			static constexpr bool split_memory { true };
+			// Compares each device built hierarchy against a host built reference
+			// on the following frame and outputs any differences. Slow.
+			static constexpr bool validate_hierarchy { false };
+			// Outputs the hierarchy cost ratio after each refit, and the build
+			// time, size and hierarchy cache hits and misses after each build.
+			static constexpr bool hierarchy_stats { false };
+			// Outputs the intersection stage traced rays per second, measured
+			// with device timestamps and the queue sizes.
+			static constexpr bool intersect_time { false };
+			// Outputs the rays left alive after each bounce on the last frame,
+			// averaged over its samples. Counts come from the bounce queues, so
+			// the megakernel backend leaves them out.
+			static constexpr bool active_rays { false };
 		};
 
 		/// <summary>
@@ -97,12 +159,59 @@ namespace Aura
 			// output directions on each sample and adds results. If 0 AA is off
 			// gen rays direction is fixed.
 			std::uint32_t anti_aliasing { 1U };
+			// Anti-aliasing samples traced together as one wavefront, each in
+			// its own rays state slice. Rays state memory grows with it, and
+			// samples are rounded up to whole batches. Creating the renderer
+			// throws if a rays state buffer would exceed the device storage
+			// buffer range.
+			std::uint32_t sample_batch { 1U };
+			// Side of the square tiles the image is traced in, one tile after
+			// the other, in pixels. Rays state is sized by a tile instead of the
+			// image, and each tile is cleared and written out within the frame,
+			// so frames do not accumulate. 0 traces the whole image at once.
+			std::uint32_t tile_size { 0U };
 			// Maximum bounces allowed for each ray.
 			std::uint32_t ray_depth { 12U };
 			// Minimum ray lifetime.
 			float t_min { 0.0000001f };
 			// Maximum ray lifetime.
 			float t_max { 2500.0f };
+			// Scene traversal used by the intersection stage. Scenes with
+			// instances always use the two level traversal.
+			TraversalModes traversal { TraversalModes::Hierarchy };
+			// Builder of the hierarchy traversal scene hierarchy.
+			HierarchyBuilders builder { HierarchyBuilders::Host };
+			// Host hierarchy cost ratio, against its last full build, past which
+			// a transform only refit is replaced by a rebuild.
+			float refit_threshold { 1.5f };
+			// Extra references fraction spatial splits may add, up to 1.
+			float spatial_budget { 0.25f };
+			// Directory of the on-disk cache of the two level traversal mesh
+			// hierarchies, empty disables it.
+			std::string hierarchy_cache {};
+			// Sorts the rays of each bounce by hit material type before shading.
+			// Pays off when materials are mixed within the image.
+			bool material_sort { false };
+			// Sorts secondary rays by direction octant and origin before each
+			// intersection, so neighbouring invocations walk the same nodes.
+			bool ray_sort { false };
+			// Path tracing backend. Ray sorting applies to the wavefront and
+			// fused backends, material sorting only to the wavefront backend.
+			RenderBackends backend { RenderBackends::Wavefront };
+			// Bounces every ray takes before Russian roulette may stop it, by
+			// its throughput. 0 disables the roulette.
+			std::uint32_t roulette_depth { 0U };
+			// Relative error under which a pixel stops taking samples, the
+			// standard error of its mean luminance over the mean. Pixels left
+			// are the only ones traced. 0 samples every pixel.
+			float adaptive_threshold { 0.0f };
+			// Samples every pixel takes before adaptive sampling may stop it.
+			std::uint32_t adaptive_min_samples { 16U };
+			// Samples a point on the emissive primitives at every diffuse hit
+			// and traces a shadow ray towards it, weighted against the diffuse
+			// bounce with multiple importance sampling. Diffuse bounces follow
+			// the cosine while on, so their density is known.
+			bool next_event { false };
 		};
 	}
 }
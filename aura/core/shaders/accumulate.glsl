@@ -0,0 +1,20 @@
+// ========================================================================== //
+// File : accumulate.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Pixel accumulation shared by the tracing stages. The including shader has
+// the pixels and moments bound.
+// Luminance weights of a pixel sample.
+#define LUMINANCE	vec3(0.2126, 0.7152, 0.0722)
+// Adds a pixel sample. Its squared luminance is added as well while adaptive
+// sampling is on, for the pixel variance.
+void accumulate(in const uint idx, in const vec4 sample_colour)
+{
+	pixels[idx] += sample_colour;
+	if(adaptive_threshold > 0.0)
+	{
+		const float l = dot(sample_colour.rgb, LUMINANCE);
+		moments[idx] += l * l;
+	}
+}
@@ -0,0 +1,170 @@
+// ========================================================================== //
+// File : intersection.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Primitive and node box tests shared by the tracing stages. Hits are only
+// accepted between t_min and the given far time.
+// Cut-off value:	0.123456789012345
+#define CUT			0.0000001
+// Determines whenever a sphere is hit or not according to the equation:
+//		t*t*dot(D,D) + 2*t*dot(D,O-C) + dot(O-C,O-C) - R*R = 0
+// Where O is the ray origin, D the ray direction, C is the center of the
+// sphere, and R is the sphere radius.
+bool sphere(
+	in restrict const vec3 o, in restrict const vec3 d,
+	in restrict const vec3 v0, in restrict const float r,
+	in const float t_far, out float t, out vec3 p, out vec3 n, out uint inside,
+	in const bool t_only)
+{
+	// Calculate quadratic constants.
+	const vec3 oc = o - v0;
+	const float a = dot(d, d);
+	const float b = 2.0 * dot(d, oc);
+	const float c = dot(oc, oc) - r * r;
+	const float descriminant = b * b - 4.0 * a * c;
+	// If descriminant is below cut point set return as miss.
+	if (descriminant < CUT) { return false; }
+	// Calculate both roots.
+	const float root = sqrt(descriminant);
+	const float div = 2.0 * a;
+	// Try negative root first, if below t_min use positive root.
+	t = (-b - root) / div;
+	bool inner = false;
+	if(t < t_min)
+	{
+		t = (-b + root) / div;
+		if(t < t_min) { return false; }
+		inner = true;
+	}
+	if(t > t_far) { return false; }
+	// Calculate point and normal.
+	if(t_only) { return true; }
+	p = o + t * d;
+	n = inner ? v0 - p : p - v0;
+	inside = uint(inner);
+	return true;
+}
+// Determines whenever a cuboid is hit or not by sequencially verifying the
+// intersection with composing planes. Works in the cuboid frame, oriented
+// cuboids move the ray first.
+bool cuboid(
+	in restrict const vec3 o, in restrict const vec3 d,
+	in restrict const vec3 v0, in restrict const vec3 v1,
+	in const float t_far, out float t, out vec3 p, out vec3 n, out uint inside,
+	in const bool t_only)
+{
+	float tmp; vec3 t_mins, t_maxs, e0, e1;
+	// Calculate inverse of direction and all times.
+	const vec3 inv_d = 1.0 / d;
+	const vec3 tv0 = (v0 - o) * inv_d;
+	const vec3 tv1 = (v1 - o) * inv_d;
+	t_mins = tv0;
+	t_maxs = tv1;
+	// Check if the line intersects the cuboid between x and y areas.
+	if(inv_d.x < 0) { tmp = t_mins.x; t_mins.x = t_maxs.x; t_maxs.x = tmp; }
+	if(inv_d.y < 0) { tmp = t_mins.y; t_mins.y = t_maxs.y; t_maxs.y = tmp; }
+	if(t_mins.x > t_maxs.y || t_mins.y > t_maxs.x) { return false; }
+	if(t_mins.x > t_mins.y) { t_mins.y = t_mins.x; }
+	if(t_maxs.x < t_maxs.y) { t_maxs.y = t_maxs.x; }
+	// Check if previous intersection also intersects z area.
+	if(inv_d.z < 0) { tmp = t_mins.z; t_mins.z = t_maxs.z; t_maxs.z = tmp; }
+	if(t_mins.y > t_maxs.z || t_mins.z > t_maxs.y) { return false; }
+	if(t_mins.y > t_mins.z) { t_mins.z = t_mins.y; }
+	if(t_maxs.y < t_maxs.z) { t_maxs.z = t_maxs.y; }
+	// Choose minimum t and verify if over t_min.
+	bool inner = false;
+	if(t_maxs.z < t_min) { return false; }
+	if(t_mins.z < t_min)
+	{ inner = true; t = t_maxs.z; }
+	else
+	{ t = t_mins.z; }
+	if(t > t_far) { return false; }
+	// Calculate point and normal.
+	if(t_only) { return true; }
+	if(t == tv0.x) { n = vec3(-1.0, 0.0, 0.0); }
+	else if(t == tv0.y) { n = vec3(0.0, -1.0, 0.0); }
+	else if(t == tv0.z) { n = vec3(0.0, 0.0, -1.0); }
+	else if(t == tv1.x) { n = vec3(1.0, 0.0, 0.0); }
+	else if(t == tv1.y) { n = vec3(0.0, 1.0, 0.0); }
+	else { n = vec3(0.0, 0.0, 1.0); }
+	p = o + t * d;
+	inside = uint(inner);
+	return true;
+}
+// Per ray constants of the watertight triangle test. The ray is moved so its
+// direction is the z axis, after permuting its largest direction axis last.
+RayShear rayShear(in const vec3 d)
+{
+	const vec3 a = abs(d);
+	const uint kz = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+	uint kx = kz == 2 ? 0 : kz + 1;
+	uint ky = kx == 2 ? 0 : kx + 1;
+	// Keep the triangles winding.
+	if(d[kz] < 0.0) { const uint tmp = kx; kx = ky; ky = tmp; }
+	return RayShear(uvec3(kx, ky, kz), vec3(d[kx] / d[kz], d[ky] / d[kz], 1.0 / d[kz]));
+}
+// Determines whenever a triangle is hit or not using the watertight
+// intersection test (Woop et al., 2013). Vertices are sheared into the ray
+// space and tested with edge functions, so rays through shared edges and
+// vertices never slip between neighbouring triangles.
+// Output values are the time of intersection, the point of intersection and
+// the precomputed normal (not normalised).
+bool triangle(
+	in restrict const vec3 o, in restrict const vec3 d,
+	in restrict const RayShear k,
+	in restrict const vec3 v0, in restrict const vec3 v1,
+	in restrict const vec3 v2, in restrict const vec3 normal,
+	in const float t_far, out float t, out vec3 p, out vec3 n, out uint inside,
+	in const bool t_only)
+{
+	// Vertices relative to the ray origin.
+	const vec3 a = v0 - o;
+	const vec3 b = v1 - o;
+	const vec3 c = v2 - o;
+	// Shear and scale the vertices.
+	const vec2 as = vec2(a[k.axes.x], a[k.axes.y]) - k.shear.xy * a[k.axes.z];
+	const vec2 bs = vec2(b[k.axes.x], b[k.axes.y]) - k.shear.xy * b[k.axes.z];
+	const vec2 cs = vec2(c[k.axes.x], c[k.axes.y]) - k.shear.xy * c[k.axes.z];
+	// Scaled barycentric coordinates, all with the same sign on a hit.
+	const float u = cs.x * bs.y - cs.y * bs.x;
+	const float v = as.x * cs.y - as.y * cs.x;
+	const float w = bs.x * as.y - bs.y * as.x;
+	if((u < 0.0 || v < 0.0 || w < 0.0) && (u > 0.0 || v > 0.0 || w > 0.0)) { return false; }
+	const float det = u + v + w;
+	if(det == 0.0) { return false; }
+	// Calculate t and verify if over t_min and below t_far.
+	const float t_scaled = k.shear.z * (u * a[k.axes.z] + v * b[k.axes.z] + w * c[k.axes.z]);
+	t = t_scaled / det;
+	if(t < t_min) { return false; }
+	if(t > t_far) { return false; }
+	// Calculate point and normal.
+	if(t_only) { return true; }
+	bool inner = dot(d, normal) > 0.0;
+	p = o + t * d;
+	n = inner ? -normal : normal;
+	inside = uint(inner);
+	return true;
+}
+// Slab test against a node box. Only entries before the given far time are
+// accepted, outputs the entry time.
+bool box(
+	in restrict const vec3 o, in restrict const vec3 inv_d,
+	in restrict const vec3 b_min, in restrict const vec3 b_max,
+	in const float t_far, out float t_near)
+{
+	const vec3 t0 = (b_min - o) * inv_d;
+	const vec3 t1 = (b_max - o) * inv_d;
+	const vec3 t_lo = min(t0, t1);
+	const vec3 t_hi = max(t0, t1);
+	t_near = max(max(t_lo.x, t_lo.y), max(t_lo.z, t_min));
+	const float t_exit = min(min(t_hi.x, t_hi.y), min(t_hi.z, t_far));
+	return t_near <= t_exit;
+}
+// Moves a ray into a cuboid frame. The direction is not normalised, so hit
+// times are the same in both frames.
+void toLocal(in const CuboidRecord b, in const vec3 o, in const vec3 d, out vec3 o_l, out vec3 d_l)
+{
+	o_l = vec3(dot(b.to_local[0], vec4(o, 1.0)), dot(b.to_local[1], vec4(o, 1.0)), dot(b.to_local[2], vec4(o, 1.0)));
+	d_l = vec3(dot(b.to_local[0].xyz, d), dot(b.to_local[1].xyz, d), dot(b.to_local[2].xyz, d));
+}
@@ -0,0 +1,200 @@
+// ========================================================================== //
+// File : occlusion.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Any hit traversal shared by the tracing stages, for rays that only need to
+// know whenever something blocks them before a given far time.
+// Any hit stack sizes, matching the hierarchy maximum depth. Up to four wide
+// children are pushed per level.
+#define ANY_STACK_SIZE		64
+#define WIDE_ANY_STACK_SIZE	256
+// Tests a sphere from its stream slot for any hit.
+bool occludesSphere(in const uint slot, in const vec3 o, in const vec3 d, in const float t_far)
+{
+	float t; vec3 p, n; uint inside;
+	return sphere(o, d, spheres[slot].center, spheres[slot].radius, t_far, t, p, n, inside, true);
+}
+// Tests a cuboid from its stream slot for any hit.
+bool occludesCuboid(in const uint slot, in const vec3 o, in const vec3 d, in const float t_far)
+{
+	float t; vec3 p, n; uint inside;
+	vec3 o_l, d_l;
+	toLocal(cuboids[slot], o, d, o_l, d_l);
+	return cuboid(o_l, d_l, cuboids[slot].min, cuboids[slot].max, t_far, t, p, n, inside, true);
+}
+// Tests a triangle from its stream slot for any hit.
+bool occludesTriangle(in const uint slot, in const vec3 o, in const vec3 d,
+	in const RayShear k, in const float t_far)
+{
+	float t; vec3 p, n; uint inside;
+	return triangle(o, d, k, triangles[slot].v0, triangles[slot].v1, triangles[slot].v2,
+		triangles[slot].normal, t_far, t, p, n, inside, true);
+}
+// Tests a single stream reference for any hit, only the time is calculated.
+bool occludes(in const uint reference, in const vec3 o, in const vec3 d,
+	in const RayShear k, in const float t_far)
+{
+	const uint type = reference >> TYPE_SHIFT;
+	const uint slot = reference & SLOT_MASK;
+	if(type == SPHERE) { return occludesSphere(slot, o, d, t_far); }
+	if(type == CUBOID) { return occludesCuboid(slot, o, d, t_far); }
+	if(type == TRIANGLE) { return occludesTriangle(slot, o, d, k, t_far); }
+	return false;
+}
+// Walks the hierarchy starting at root until the first hit. Children are
+// visited in any order, there is no closest hit to cull with.
+bool traverseAny(in const uint root, in const vec3 o, in const vec3 d, in const float t_far)
+{
+	const vec3 inv_d = 1.0 / d;
+	const RayShear k = rayShear(d);
+	uint stack[ANY_STACK_SIZE];
+	uint top = 0;
+	uint node = root;
+	float t_near;
+	if(!box(o, inv_d, nodes[root].min, nodes[root].max, t_far, t_near)) { return false; }
+	while(true)
+	{
+		const uint left = nodes[node].left;
+		const uint right = nodes[node].right;
+		if((left & LEAF) != 0)
+		{
+			const uint first = left & ~LEAF;
+			for(uint i = first; i < first + right; ++i)
+			{
+				if(occludes(references[i], o, d, k, t_far)) { return true; }
+			}
+		}
+		else
+		{
+			const bool hit_left = box(o, inv_d, nodes[left].min, nodes[left].max, t_far, t_near);
+			const bool hit_right = box(o, inv_d, nodes[right].min, nodes[right].max, t_far, t_near);
+			if(hit_left && hit_right)
+			{
+				node = left;
+				stack[top++] = right;
+				continue;
+			}
+			if(hit_left) { node = left; continue; }
+			if(hit_right) { node = right; continue; }
+		}
+		if(top == 0) { break; }
+		node = stack[--top];
+	}
+	return false;
+}
+// Walks the top level hierarchy over entity instances until the first hit,
+// moving the ray to each instance object space. Hit times are the same in
+// both spaces.
+bool traverseInstancesAny(in const vec3 o, in const vec3 d, in const float t_far)
+{
+	const vec3 inv_d = 1.0 / d;
+	uint stack[ANY_STACK_SIZE];
+	uint top = 0;
+	uint node = 0;
+	float t_near;
+	if(!box(o, inv_d, nodes[0].min, nodes[0].max, t_far, t_near)) { return false; }
+	while(true)
+	{
+		const uint left = nodes[node].left;
+		const uint right = nodes[node].right;
+		if((left & LEAF) != 0)
+		{
+			const uint first = left & ~LEAF;
+			for(uint i = first; i < first + right; ++i)
+			{
+				const Instance record = instances[references[i]];
+				const mat4 world_to_object = record.world_to_object;
+				if(traverseAny(record.root, vec3(world_to_object * vec4(o, 1.0)), mat3(world_to_object) * d, t_far))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			const bool hit_left = box(o, inv_d, nodes[left].min, nodes[left].max, t_far, t_near);
+			const bool hit_right = box(o, inv_d, nodes[right].min, nodes[right].max, t_far, t_near);
+			if(hit_left && hit_right)
+			{
+				node = left;
+				stack[top++] = right;
+				continue;
+			}
+			if(hit_left) { node = left; continue; }
+			if(hit_right) { node = right; continue; }
+		}
+		if(top == 0) { break; }
+		node = stack[--top];
+	}
+	return false;
+}
+// Walks the wide hierarchy until the first hit, testing leaf children right
+// away and pushing every hit interior child.
+bool traverseWideAny(in const vec3 o, in const vec3 d, in const float t_far)
+{
+	const vec3 inv_d = 1.0 / d;
+	const RayShear k = rayShear(d);
+	uint stack[WIDE_ANY_STACK_SIZE];
+	uint top = 0;
+	stack[top++] = 0;
+	while(top > 0)
+	{
+		const WideNode wide = wide_nodes[stack[--top]];
+		const vec3 step = vec3(
+			uintBitsToFloat((wide.exponents & 0xFFu) << 23),
+			uintBitsToFloat(((wide.exponents >> 8) & 0xFFu) << 23),
+			uintBitsToFloat(((wide.exponents >> 16) & 0xFFu) << 23));
+		for(uint i = 0; i < WIDTH; ++i)
+		{
+			const uint child = wide.children[i];
+			if(child == EMPTY_CHILD) { continue; }
+			const uint shift = 8u * i;
+			const vec3 lo = vec3(
+				(wide.bounds_xy.x >> shift) & 0xFFu,
+				(wide.bounds_xy.z >> shift) & 0xFFu,
+				(wide.bounds_z.x >> shift) & 0xFFu);
+			const vec3 hi = vec3(
+				(wide.bounds_xy.y >> shift) & 0xFFu,
+				(wide.bounds_xy.w >> shift) & 0xFFu,
+				(wide.bounds_z.y >> shift) & 0xFFu);
+			float t_near;
+			if(!box(o, inv_d, wide.origin + lo * step, wide.origin + hi * step, t_far, t_near)) { continue; }
+			if((child & LEAF) != 0)
+			{
+				const uint first = child & ~LEAF;
+				const uint count = (wide.bounds_z.z >> shift) & 0xFFu;
+				for(uint r = first; r < first + count; ++r)
+				{
+					if(occludes(references[r], o, d, k, t_far)) { return true; }
+				}
+				continue;
+			}
+			stack[top++] = child;
+		}
+	}
+	return false;
+}
+// Tests if anything blocks the ray before the given far time, with the scene
+// traversal.
+bool blocked(in const vec3 o, in const vec3 d, in const float t_far)
+{
+	if(traversal == HIERARCHY)
+	{
+		return traverseAny(0, o, d, t_far);
+	}
+	if(traversal == TWO_LEVEL)
+	{
+		return traverseInstancesAny(o, d, t_far);
+	}
+	if(traversal == WIDE)
+	{
+		return traverseWideAny(o, d, t_far);
+	}
+	bool hit = false;
+	const RayShear k = rayShear(d);
+	for(uint i = 0; i < n_spheres && !hit; ++i) { hit = occludesSphere(i, o, d, t_far); }
+	for(uint i = 0; i < n_cuboids && !hit; ++i) { hit = occludesCuboid(i, o, d, t_far); }
+	for(uint i = 0; i < n_triangles && !hit; ++i) { hit = occludesTriangle(i, o, d, k, t_far); }
+	return hit;
+}
@@ -0,0 +1,20 @@
+// ========================================================================== //
+// File : queue-slot.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Positions within the ray queues, shared by the queued stages.
+#ifndef QUEUE_SLOT_GLSL
+#define QUEUE_SLOT_GLSL
+// Work group size of the queued stages.
+#define QUEUE_GSIZE	64
+// Work groups along x of the queued dispatches, the least every device
+// supports. Longer queues are dispatched in rows of groups.
+#define QUEUE_ROW	65535u
+// Position of the invocation within the queue it was dispatched from. The
+// last row of groups may reach past the queued rays.
+uint queueSlot()
+{
+	return (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * QUEUE_GSIZE + gl_LocalInvocationID.x;
+}
+#endif
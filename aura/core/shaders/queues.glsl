@@ -0,0 +1,21 @@
+// ========================================================================== //
+// File : queues.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Ray queues shared by the queued stages. The including shader has the
+// queues and queue arguments bound.
+#include "queue-slot.glsl"
+// Appends a ray to the given queue. The first ray of each work group
+// worth of rays also grows the queue dispatch, a row of groups at a time.
+void enqueue(in const uint q, in const uint idx)
+{
+	const uint slot = atomicAdd(queue_args[q].count, 1);
+	queues[q * width * height * batch + slot] = idx;
+	if(slot % QUEUE_GSIZE == 0)
+	{
+		const uint group = slot / QUEUE_GSIZE;
+		atomicMax(queue_args[q].x, min(group + 1, QUEUE_ROW));
+		atomicMax(queue_args[q].y, group / QUEUE_ROW + 1);
+	}
+}
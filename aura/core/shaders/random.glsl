@@ -0,0 +1,40 @@
+// ========================================================================== //
+// File : random.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Random numbers shared by the tracing stages. The including shader has the
+// frame and sample push constants.
+// Tries at a random point before giving up on the unit sphere.
+#define POINT_TRIES	16
+// Random number state of the invocation.
+uint rng_state;
+// PCG hash, by Jarzynski and Olano.
+uint pcg(in const uint v)
+{
+	const uint state = v * 747796405u + 2891336453u;
+	const uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+// Seeds the invocation random numbers with a hash of the ray, sample, bounce
+// and frame, so every path draws its own numbers at every bounce.
+void seedRandom(in const uint idx, in const uint bounce)
+{
+	rng_state = pcg(idx ^ pcg(sample_idx ^ pcg(bounce ^ pcg(frame))));
+}
+// Next random number, in [0,1).
+float random()
+{
+	rng_state = pcg(rng_state);
+	return float(rng_state >> 8) / 16777216.0;
+}
+// Random point within the unit sphere, by rejection.
+vec3 randomInSphere()
+{
+	for(uint i = 0; i < POINT_TRIES; ++i)
+	{
+		const vec3 p = vec3(random(), random(), random()) * 2.0 - 1.0;
+		if(dot(p, p) <= 1.0) { return p; }
+	}
+	return vec3(0.0);
+}
@@ -0,0 +1,37 @@
+// ========================================================================== //
+// File : scene.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Scene bindings read by the tracing stages. The including shader defines
+// SCENE_SET, the descriptor set the scene is bound to.
+layout(std140, set = SCENE_SET, binding = 1) buffer restrict readonly Transforms {
+	Transform[] transforms;
+};
+layout(std140, set = SCENE_SET, binding = 2) buffer restrict readonly Materials {
+	Material[] materials;
+};
+layout(std140, set = SCENE_SET, binding = 4) buffer restrict readonly Nodes {
+	Node[] nodes;
+};
+layout(std430, set = SCENE_SET, binding = 5) buffer restrict readonly References {
+	uint[] references;
+};
+layout(std140, set = SCENE_SET, binding = 6) buffer restrict readonly Instances {
+	Instance[] instances;
+};
+layout(std430, set = SCENE_SET, binding = 7) buffer restrict readonly WideNodes {
+	WideNode[] wide_nodes;
+};
+layout(std430, set = SCENE_SET, binding = 8) buffer restrict readonly Spheres {
+	SphereRecord[] spheres;
+};
+layout(std430, set = SCENE_SET, binding = 9) buffer restrict readonly Cuboids {
+	CuboidRecord[] cuboids;
+};
+layout(std430, set = SCENE_SET, binding = 10) buffer restrict readonly Triangles {
+	TriangleRecord[] triangles;
+};
+layout(std430, set = SCENE_SET, binding = 12) buffer restrict readonly Lights {
+	LightRecord[] lights;
+};
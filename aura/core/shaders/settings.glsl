@@ -0,0 +1,28 @@
+// ========================================================================== //
+// File : settings.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Render settings, as laid out by the host.
+layout(std140, set = 0, binding = 0) uniform Settings {
+	float t_min;
+	float t_max;
+	uint n_bounces;
+	uint n_samples;
+	uint n_primitives;
+	uint width;
+	uint height;
+	uint traversal;
+	uint n_spheres;
+	uint n_cuboids;
+	uint n_triangles;
+	uint batch;
+	uint roulette_depth;
+	uint image_width;
+	uint image_height;
+	float adaptive_threshold;
+	uint adaptive_min;
+	uint next_event;
+	uint n_lights;
+	float light_area;
+};
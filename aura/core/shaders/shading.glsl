@@ -0,0 +1,311 @@
+// ========================================================================== //
+// File : shading.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Absorption, colouring and scattering shared by the tracing stages. Lights
+// are sampled from diffuse hits, the including shader traces the shadow rays.
+// Minimum distance from origin:	0.123456789012345
+#define MIN_DIST		0.0000001
+#define PI				3.14159265358979
+// Fraction of the way to their light point shadow rays stop short of.
+#define SHADOW_EPS		0.001
+// Russian roulette survival probability limits.
+#define MIN_SURVIVAL	0.05
+#define MAX_SURVIVAL	0.95
+// Shadow ray that is never traced.
+#define NO_SHADOW		ShadowRay(vec3(0.0), 0.0, vec3(0.0), 0, vec3(0.0))
+// Random point of the bounce being shaded.
+vec3 rnd_point;
+// Russian roulette. Once the roulette depth is reached, rays survive with a
+// probability following their throughput and survivors are weighted up, so
+// the estimate stays unbiased. Returns whenever the ray survives.
+bool roulette(inout vec3 albedo, in const uint bounce)
+{
+	if(roulette_depth == 0 || bounce + 1 < roulette_depth) { return true; }
+	const float p = clamp(max(albedo.r, max(albedo.g, albedo.b)), MIN_SURVIVAL, MAX_SURVIVAL);
+	if(random() >= p) { return false; }
+	albedo /= p;
+	return true;
+}
+// Whenever paths out of bounces count as a sample, with no more colour.
+// Paths stopped by the roulette count with no colour, and so do those
+// that sampled the lights on the way, so all paths out of bounces must
+// count as well for the pixel mean to keep its scale.
+bool countExhausted()
+{
+	return bool(next_event) || roulette_depth != 0;
+}
+// Test albedo.
+vec3 test_albedo(in const vec3 n)
+{
+	return (n + 1.0) * 0.5;
+}
+// Alpha albedo.
+vec3 alpha_albedo(in const vec3 albedo, in const float alpha)
+{
+	return alpha * albedo + 1.0 - alpha;
+}
+// Background albedo.
+vec3 background_albedo(in const vec3 d)
+{
+	const float vr = (d.y + 1.0) * 0.5;
+	const vec3 bottom = vec3(0.5, 0.5, 0.5) * (1.0 - vr);
+	const vec3 top = vec3(1.0, 1.0, 1.0) * vr;
+	return bottom + top;
+}
+// Diffuse reflection. Random directions above surface.
+vec3 diffuse_reflection(in const vec3 n)
+{
+	vec3 nd = n + rnd_point * 0.7;
+	if (nd == vec3(0.0))
+	{ return n; }
+	else
+	{ return nd; }
+}
+// Cosine weighted diffuse reflection. Adds a random point on the unit sphere
+// to the unit normal, so directions follow the cosine to the normal.
+vec3 cosine_reflection(in const vec3 n)
+{
+	if(rnd_point == vec3(0.0)) { return n; }
+	const vec3 nd = n + normalize(rnd_point);
+	if(dot(nd, nd) < MIN_DIST)
+	{ return n; }
+	else
+	{ return nd; }
+}
+// Specular reflection. Uses surface normal and fuzziness constant.
+vec3 specular_reflection(in const vec3 n, in const vec3 d, in const float fuzz)
+{
+	return reflect(d, n) + rnd_point * fuzz;
+}
+// Christophe Schlick approximation.
+float schlick (in float cosine, in float r_idx)
+{
+	float r0 = (1 - r_idx) / (1 + r_idx);
+	r0 = r0 * r0;
+	return r0 + (1 - r0) * pow( (1 - cosine), 5 );
+}
+// Refraction. Uses both inside or outside situation and schlick approximation.
+bool refraction(in const vec3 n, in const vec3 d, in const float r_idx,
+	in const bool inside, out vec3 nd)
+{
+	// float cosine; float prob;
+
+	if(inside)
+	{
+		// cosine = r_idx * dot(d, -n);
+		nd = refract(d, n, r_idx);
+	}
+	else
+	{
+		// cosine = -dot(d, n);
+		nd = refract(d, n, 1.0 / r_idx);
+	}
+	/*
+	if(nd == vec3(0.0))
+	{ prob = 1.0; }
+	else
+	{ prob = schlick(cosine, r_idx); }
+	if (random() < prob)
+	{ return false; }
+	else
+	{ return true; }
+	*/
+	if(nd == vec3(0.0))
+	{ return false; }
+	else
+	{ return true; }
+}
+// Miss. Updates with a background definition and stops the ray. Returns
+// the new pixel sample.
+vec4 miss(inout Ray ray, in const vec3 albedo)
+{
+	ray.albedo *= albedo;
+	ray.missed = 1;
+	return vec4(ray.albedo, 1.0);
+}
+// Diffuse. Updates with the material albedo and reflects rays in random
+// directions. While the lights are sampled, directions follow the cosine and
+// keep their density, to weight the lights they hit.
+void diffuse(inout Ray ray, in const Hit h, in const vec3 albedo)
+{
+	ray.albedo *= albedo;
+	if(bool(next_event) && n_lights > 0)
+	{
+		ray.direction = cosine_reflection(h.normal);
+		ray.pdf = max(dot(h.normal, normalize(ray.direction)), 0.0) / PI;
+	}
+	else
+	{
+		ray.direction = diffuse_reflection(h.normal);
+	}
+}
+// Specular. Updates with the material albedo based on the intensity level
+// and either reflect or refract the ray.
+void specular(inout Ray ray, in const Hit h, in const vec3 albedo)
+{
+	const float alpha = materials[h.m_idx].colour.a;
+	const float r_idx = materials[h.m_idx].r_idx;
+	const float fuzz  = materials[h.m_idx].fuzz;
+
+	if (alpha < 1.0)
+	{
+		vec3 nd;
+		if(refraction(h.normal, ray.direction, r_idx, bool(h.inside), nd))
+		{ ray.direction = nd; }
+		else
+		{ ray.direction = specular_reflection(h.normal, ray.direction, fuzz); }
+		ray.albedo *= alpha_albedo(albedo, alpha);
+	}
+	else
+	{
+		ray.direction = specular_reflection(h.normal, ray.direction, fuzz);
+		ray.albedo *= albedo;
+	}
+}
+// Emissive. Updates with the material albedo based on the intensity level
+// and either refract or stop the ray. Returns the new pixel sample.
+vec4 emissive(inout Ray ray, in const Hit h, in const vec3 albedo)
+{
+	const float alpha = materials[h.m_idx].colour.a;
+	const float r_idx = materials[h.m_idx].r_idx;
+
+	if (alpha < 1.0)
+	{
+		vec3 nd;
+		if(refraction(h.normal, ray.direction, r_idx, bool(h.inside), nd))
+		{ ray.direction = nd; }
+		else
+		{ ray.missed = 1; }
+		ray.albedo *= alpha_albedo(albedo, alpha);
+	}
+	else
+	{
+		ray.albedo *= albedo * alpha;
+		ray.missed = 1;
+	}
+	return vec4(ray.albedo, 1.0);
+}
+// Light given off by an emissive material, as collected by emissive hits.
+vec3 emission(in const uint m_idx)
+{
+	const vec3 albedo = materials[m_idx].colour.rgb;
+	const float alpha = materials[m_idx].colour.a;
+	return alpha < 1.0 ? alpha_albedo(albedo, alpha) : albedo * alpha;
+}
+// Power heuristic weight of a sample against another technique.
+float powerHeuristic(in const float pdf, in const float other_pdf)
+{
+	const float a = pdf * pdf;
+	return a / (a + other_pdf * other_pdf);
+}
+// Solid angle density of a light point met at the given distance and
+// cosine. Lights are picked by their area, so every light point has the
+// same area density, one over the total light area.
+float lightPdf(in const float dist, in const float cosine)
+{
+	return dist * dist / (cosine * light_area);
+}
+// Picks a light by its area, from the cumulative areas, and a point on it.
+// Outputs the point, its unit normal and the light material.
+void sampleLight(out vec3 y, out vec3 ny, out uint m_idx)
+{
+	const float u = random();
+	uint lo = 0;
+	uint hi = n_lights - 1;
+	while(lo < hi)
+	{
+		const uint mid = (lo + hi) / 2;
+		if(lights[mid].cdf < u) { lo = mid + 1; } else { hi = mid; }
+	}
+	const LightRecord light = lights[lo];
+	m_idx = light.m_idx;
+	if(light.type == SPHERE)
+	{
+		const float z = 1.0 - 2.0 * random();
+		const float phi = 2.0 * PI * random();
+		const float r = sqrt(max(0.0, 1.0 - z * z));
+		ny = vec3(r * cos(phi), r * sin(phi), z);
+		y = light.v0 + light.radius * ny;
+	}
+	else
+	{
+		const float s = sqrt(random());
+		const float t = random();
+		y = light.v0 * (1.0 - s) + light.v1 * (s * (1.0 - t)) + light.v2 * (s * t);
+		ny = normalize(cross(light.v1 - light.v0, light.v2 - light.v0));
+	}
+}
+// Next event estimation. Samples a light point from the hit and outputs the
+// shadow ray towards it, carrying the light it brings through the diffuse
+// surface, weighted against the diffuse bounce. The shadow ray is left dead if
+// the light point faces away. Must come before the surface colours the ray.
+ShadowRay nextEvent(in const Ray ray, in const Hit h, in const vec3 albedo)
+{
+	ShadowRay shadow = NO_SHADOW;
+	vec3 y, ny;
+	uint m_idx;
+	sampleLight(y, ny, m_idx);
+	const vec3 to_light = y - h.point;
+	const float dist = length(to_light);
+	if(dist == 0.0) { return shadow; }
+	const vec3 wi = to_light / dist;
+	const float cos_x = dot(h.normal, wi);
+	const float cos_y = abs(dot(ny, wi));
+	if(cos_x <= 0.0 || cos_y <= 0.0) { return shadow; }
+	const float light_pdf = lightPdf(dist, cos_y);
+	const float weight = powerHeuristic(light_pdf, cos_x / PI);
+	shadow.origin = h.point + MIN_DIST * wi;
+	shadow.reach = dist * (1.0 - SHADOW_EPS);
+	shadow.direction = wi;
+	shadow.live = 1;
+	shadow.radiance = ray.albedo * albedo * emission(m_idx) * (cos_x / PI) * weight / light_pdf;
+	return shadow;
+}
+// Absorbs, colours and scatters the ray at its hit. Returns the new pixel
+// sample, and outputs the shadow ray towards the light sampled at the hit.
+vec4 shade(inout Ray ray, in const Hit h, out ShadowRay shadow)
+{
+	vec4 sample_colour = vec4(0.0);
+	shadow = NO_SHADOW;
+	// Density of the direction that met this hit, only diffuse bounces keep
+	// theirs for the next.
+	const float pdf = ray.pdf;
+	ray.pdf = 0.0;
+	if(h.time == 0.0)
+	{
+		sample_colour = miss(ray, background_albedo(ray.direction));
+	}
+	else if(materials[h.m_idx].type == TEST)
+	{
+		sample_colour = emissive(ray, h, test_albedo(h.normal));
+	}
+	else if(materials[h.m_idx].type == DIFFUSE)
+	{
+		if(bool(next_event) && n_lights > 0)
+		{
+			shadow = nextEvent(ray, h, materials[h.m_idx].colour.rgb);
+		}
+		diffuse(ray, h, materials[h.m_idx].colour.rgb);
+	}
+	else if(materials[h.m_idx].type == SPECULAR)
+	{
+		specular(ray, h, materials[h.m_idx].colour.rgb);
+	}
+	else if(materials[h.m_idx].type == EMISSIVE)
+	{
+		// Lights met by a diffuse bounce were sampled at its hit as well.
+		const float cosine = abs(dot(h.normal, ray.direction));
+		const float weight = pdf > 0.0 && cosine > 0.0 ? powerHeuristic(pdf, lightPdf(h.time, cosine)) : 1.0;
+		sample_colour = emissive(ray, h, materials[h.m_idx].colour.rgb);
+		sample_colour.rgb *= weight;
+	}
+	else
+	{
+		sample_colour = vec4(1.0, 0.0, 1.0, 1.0);
+	}
+	ray.direction = normalize(ray.direction);
+	ray.origin = h.point + MIN_DIST * ray.direction;
+	return sample_colour;
+}
@@ -0,0 +1,119 @@
+// ========================================================================== //
+// File : structures.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Structures shared by the tracing stages, as laid out by the host.
+struct Ray {
+	vec3 origin;
+	vec3 direction;
+	float pdf;
+	vec3 albedo;
+	uint missed;
+	vec4 colour;
+};
+struct Hit {
+	vec3 point;
+	float time;
+	vec3 normal;
+	uint m_idx;
+	uint inside;
+};
+struct ShadowRay {
+	vec3 origin;
+	float reach;
+	vec3 direction;
+	uint live;
+	vec3 radiance;
+};
+struct Transform {
+	mat4 t;
+	mat4 s;
+	mat4 r;
+};
+struct Material {
+	vec4 colour;
+	uint type;
+	float r_idx;
+	float fuzz;
+};
+struct Node {
+	vec3 min;
+	uint left;
+	vec3 max;
+	uint right;
+};
+struct Instance {
+	mat4 world_to_object;
+	uint root;
+	uint m_idx;
+};
+struct SphereRecord {
+	vec3 center;
+	float radius;
+	uint m_idx;
+};
+struct CuboidRecord {
+	vec4 to_local[3];
+	vec3 min;
+	uint m_idx;
+	vec3 max;
+};
+struct TriangleRecord {
+	vec3 v0;
+	uint m_idx;
+	vec3 v1;
+	vec3 v2;
+	vec3 normal;
+};
+struct RayShear {
+	uvec3 axes;
+	vec3 shear;
+};
+struct WideNode {
+	vec3 origin;
+	uint exponents;
+	uvec4 bounds_xy;
+	uvec4 bounds_z;
+	uvec4 children;
+};
+struct LightRecord {
+	vec3 v0;
+	uint type;
+	vec3 v1;
+	float radius;
+	vec3 v2;
+	uint m_idx;
+	float area;
+	float cdf;
+};
+struct RayQueue {
+	uint x;
+	uint y;
+	uint z;
+	uint count;
+};
+// Primitive types:
+#define EMPTY		0
+#define SPHERE		1
+#define CUBOID		2
+#define TRIANGLE	3
+// Stream reference type position and slot bits.
+#define TYPE_SHIFT	30
+#define SLOT_MASK	0x3FFFFFFFu
+// Traversal modes:
+#define LINEAR		0
+#define HIERARCHY	1
+#define TWO_LEVEL	2
+#define WIDE		3
+// Leaf node flag.
+#define LEAF		0x80000000u
+// Wide node children and empty child slot.
+#define WIDTH		4
+#define EMPTY_CHILD	0xFFFFFFFFu
+// Material types.
+#define BOUNDING	0
+#define TEST		1
+#define DIFFUSE		2
+#define SPECULAR	3
+#define EMISSIVE	4
@@ -0,0 +1,259 @@
+// ========================================================================== //
+// File : traversal.glsl
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+// Closest hit traversal shared by the tracing stages, over the primitive
+// streams or either of the hierarchies.
+// Traversal stack size, matches the hierarchy maximum depth.
+#define STACK_SIZE	64
+// Wide traversal stack size, up to three children are pushed per level.
+#define WIDE_STACK_SIZE	192
+// Keeps the given hit if it is the closest so far.
+void keep(in const bool hit, in const Hit h, in const uint m_idx, inout Hit c)
+{
+	if(hit && (c.time == 0.0 || h.time < c.time))
+	{
+		c = h;
+		c.m_idx = m_idx;
+	}
+}
+// Tests a sphere from its stream slot.
+void closestSphere(in const uint slot, in const vec3 o, in const vec3 d, inout Hit c)
+{
+	Hit h = Hit(vec3(0.0), 0.0, vec3(0.0), 0, 0);
+	const SphereRecord s = spheres[slot];
+	const bool hit = sphere(o, d, s.center, s.radius, t_max, h.time, h.point, h.normal, h.inside, false);
+	keep(hit, h, s.m_idx, c);
+}
+// Tests a cuboid from its stream slot.
+void closestCuboid(in const uint slot, in const vec3 o, in const vec3 d, inout Hit c)
+{
+	Hit h = Hit(vec3(0.0), 0.0, vec3(0.0), 0, 0);
+	const CuboidRecord b = cuboids[slot];
+	vec3 o_l, d_l;
+	toLocal(b, o, d, o_l, d_l);
+	if(!cuboid(o_l, d_l, b.min, b.max, t_max, h.time, h.point, h.normal, h.inside, false)) { return; }
+	// Back to world space, normals by the inverse transpose.
+	h.point = o + h.time * d;
+	h.normal = mat3(b.to_local[0].xyz, b.to_local[1].xyz, b.to_local[2].xyz) * h.normal;
+	keep(true, h, b.m_idx, c);
+}
+// Tests a triangle from its stream slot.
+void closestTriangle(in const uint slot, in const vec3 o, in const vec3 d,
+	in const RayShear k, inout Hit c)
+{
+	Hit h = Hit(vec3(0.0), 0.0, vec3(0.0), 0, 0);
+	const TriangleRecord t = triangles[slot];
+	const bool hit = triangle(o, d, k, t.v0, t.v1, t.v2, t.normal, t_max, h.time, h.point, h.normal, h.inside, false);
+	keep(hit, h, t.m_idx, c);
+}
+// Tests a single stream reference and keeps the hit if it is the closest so
+// far. The type comes from the reference, primitives are never read.
+void closest(in const uint reference, in const vec3 o, in const vec3 d,
+	in const RayShear k, inout Hit c)
+{
+	const uint type = reference >> TYPE_SHIFT;
+	const uint slot = reference & SLOT_MASK;
+	if(type == SPHERE) { closestSphere(slot, o, d, c); }
+	else if(type == CUBOID) { closestCuboid(slot, o, d, c); }
+	else if(type == TRIANGLE) { closestTriangle(slot, o, d, k, c); }
+}
+// Walks the hierarchy starting at root front to back, skipping nodes farther
+// than the closest hit found so far.
+void traverse(in const uint root, in const vec3 o, in const vec3 d, inout Hit c)
+{
+	const vec3 inv_d = 1.0 / d;
+	const RayShear k = rayShear(d);
+	uint stack[STACK_SIZE];
+	uint top = 0;
+	uint node = root;
+	float t_near, t_left, t_right;
+	if(!box(o, inv_d, nodes[root].min, nodes[root].max, t_max, t_near)) { return; }
+	while(true)
+	{
+		const uint left = nodes[node].left;
+		const uint right = nodes[node].right;
+		if((left & LEAF) != 0)
+		{
+			const uint first = left & ~LEAF;
+			for(uint i = first; i < first + right; ++i)
+			{
+				closest(references[i], o, d, k, c);
+			}
+		}
+		else
+		{
+			const float t_far = c.time == 0.0 ? t_max : c.time;
+			const bool hit_left = box(o, inv_d, nodes[left].min, nodes[left].max, t_far, t_left);
+			const bool hit_right = box(o, inv_d, nodes[right].min, nodes[right].max, t_far, t_right);
+			if(hit_left && hit_right)
+			{
+				// Visit the nearest child first, push the other.
+				node = t_left <= t_right ? left : right;
+				stack[top++] = t_left <= t_right ? right : left;
+				continue;
+			}
+			if(hit_left) { node = left; continue; }
+			if(hit_right) { node = right; continue; }
+		}
+		if(top == 0) { break; }
+		node = stack[--top];
+	}
+}
+// Tests an entity instance. The ray is moved to object space without
+// normalising its direction, so hit times are the same in both spaces and only
+// the point and normal need to be moved back. The material is the instance one.
+void instance(in const uint i, in const vec3 o, in const vec3 d, inout Hit c)
+{
+	const mat4 world_to_object = instances[i].world_to_object;
+	Hit h = c;
+	traverse(instances[i].root, vec3(world_to_object * vec4(o, 1.0)), mat3(world_to_object) * d, h);
+	if(h.time != c.time)
+	{
+		c = h;
+		c.point = o + c.time * d;
+		c.normal = transpose(mat3(world_to_object)) * c.normal;
+		c.m_idx = instances[i].m_idx;
+	}
+}
+// Walks the top level hierarchy over entity instances, then each instance
+// bottom level hierarchy in object space.
+void traverseInstances(in const vec3 o, in const vec3 d, inout Hit c)
+{
+	const vec3 inv_d = 1.0 / d;
+	uint stack[STACK_SIZE];
+	uint top = 0;
+	uint node = 0;
+	float t_near, t_left, t_right;
+	if(!box(o, inv_d, nodes[0].min, nodes[0].max, t_max, t_near)) { return; }
+	while(true)
+	{
+		const uint left = nodes[node].left;
+		const uint right = nodes[node].right;
+		if((left & LEAF) != 0)
+		{
+			const uint first = left & ~LEAF;
+			for(uint i = first; i < first + right; ++i)
+			{
+				instance(references[i], o, d, c);
+			}
+		}
+		else
+		{
+			const float t_far = c.time == 0.0 ? t_max : c.time;
+			const bool hit_left = box(o, inv_d, nodes[left].min, nodes[left].max, t_far, t_left);
+			const bool hit_right = box(o, inv_d, nodes[right].min, nodes[right].max, t_far, t_right);
+			if(hit_left && hit_right)
+			{
+				node = t_left <= t_right ? left : right;
+				stack[top++] = t_left <= t_right ? right : left;
+				continue;
+			}
+			if(hit_left) { node = left; continue; }
+			if(hit_right) { node = right; continue; }
+		}
+		if(top == 0) { break; }
+		node = stack[--top];
+	}
+}
+// Walks the wide hierarchy. Child boxes are decoded from their 8 bit planes
+// on the node grid, leaf children are tested right away and hit interior
+// children are visited nearest first.
+void traverseWide(in const vec3 o, in const vec3 d, inout Hit c)
+{
+	const vec3 inv_d = 1.0 / d;
+	const RayShear k = rayShear(d);
+	uint stack[WIDE_STACK_SIZE];
+	uint top = 0;
+	uint node = 0;
+	while(true)
+	{
+		const WideNode wide = wide_nodes[node];
+		const vec3 step = vec3(
+			uintBitsToFloat((wide.exponents & 0xFFu) << 23),
+			uintBitsToFloat(((wide.exponents >> 8) & 0xFFu) << 23),
+			uintBitsToFloat(((wide.exponents >> 16) & 0xFFu) << 23));
+		// Hit interior children, sorted by entry time.
+		uint hit_nodes[WIDTH];
+		float hit_times[WIDTH];
+		uint n_hits = 0;
+		for(uint i = 0; i < WIDTH; ++i)
+		{
+			const uint child = wide.children[i];
+			if(child == EMPTY_CHILD) { continue; }
+			const uint shift = 8u * i;
+			const vec3 lo = vec3(
+				(wide.bounds_xy.x >> shift) & 0xFFu,
+				(wide.bounds_xy.z >> shift) & 0xFFu,
+				(wide.bounds_z.x >> shift) & 0xFFu);
+			const vec3 hi = vec3(
+				(wide.bounds_xy.y >> shift) & 0xFFu,
+				(wide.bounds_xy.w >> shift) & 0xFFu,
+				(wide.bounds_z.y >> shift) & 0xFFu);
+			const float t_far = c.time == 0.0 ? t_max : c.time;
+			float t_near;
+			if(!box(o, inv_d, wide.origin + lo * step, wide.origin + hi * step, t_far, t_near)) { continue; }
+			if((child & LEAF) != 0)
+			{
+				const uint first = child & ~LEAF;
+				const uint count = (wide.bounds_z.z >> shift) & 0xFFu;
+				for(uint r = first; r < first + count; ++r)
+				{
+					closest(references[r], o, d, k, c);
+				}
+				continue;
+			}
+			uint j = n_hits++;
+			for(; j > 0 && hit_times[j - 1] > t_near; --j)
+			{
+				hit_nodes[j] = hit_nodes[j - 1];
+				hit_times[j] = hit_times[j - 1];
+			}
+			hit_nodes[j] = child;
+			hit_times[j] = t_near;
+		}
+		if(n_hits > 0)
+		{
+			// Visit the nearest child, push the others farthest first.
+			for(uint i = n_hits - 1; i > 0; --i)
+			{
+				stack[top++] = hit_nodes[i];
+			}
+			node = hit_nodes[0];
+			continue;
+		}
+		if(top == 0) { break; }
+		node = stack[--top];
+	}
+}
+// Finds the closest intersection, either through one of the hierarchies or by
+// testing every primitive stream. Hits farther than the given one are never
+// kept.
+void closestHit(in const vec3 o, in const vec3 d, inout Hit c)
+{
+	if(traversal == HIERARCHY)
+	{
+		traverse(0, o, d, c);
+	}
+	else if(traversal == TWO_LEVEL)
+	{
+		traverseInstances(o, d, c);
+	}
+	else if(traversal == WIDE)
+	{
+		traverseWide(o, d, c);
+	}
+	else
+	{
+		// One loop per stream, so lanes never diverge on the type.
+		const RayShear k = rayShear(d);
+		for(uint i = 0; i < n_spheres; ++i) { closestSphere(i, o, d, c); }
+		for(uint i = 0; i < n_cuboids; ++i) { closestCuboid(i, o, d, c); }
+		for(uint i = 0; i < n_triangles; ++i) { closestTriangle(i, o, d, k, c); }
+	}
+	if(c.time > 0.0)
+	{
+		c.normal = normalize(c.normal);
+	}
+}
@@ -0,0 +1,260 @@
+// ========================================================================== //
+// File : hierarchy-cache.cpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#include <Aura/Core/Environment/hierarchy-cache.hpp>
+// Internal includes.
+#include <Aura/Core/Environment/hierarchy.hpp>
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Aura::Core
+{
+	// ------------------------------------------------------------------ //
+	// Set-up and tear-down.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Waits for the background writes.
+	/// </summary>
+	HierarchyCache::~HierarchyCache() noexcept
+	{
+		wait();
+	}
+
+	// ------------------------------------------------------------------ //
+	// Construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Loads the mesh hierarchy of the given key from the cache, or builds it
+	/// over the given object space boxes on a miss. Misses are only written
+	/// on the next flush. Returns whenever it was a hit.
+	/// </summary>
+	bool HierarchyCache::build(std::uint64_t const key, std::vector<Bounds> const & bounds, Hierarchy & hierarchy)
+	{
+		if(directory.empty())
+		{
+			hierarchy.build(bounds);
+			return false;
+		}
+		std::uint32_t const n_bounds { static_cast<std::uint32_t>(bounds.size()) };
+		if(load(key, n_bounds, hierarchy))
+		{
+			// Hits count as uses, so eviction keeps the file.
+			std::error_code error {};
+			std::filesystem::last_write_time(file(directory, key), std::filesystem::file_time_type::clock::now(), error);
+			++hits;
+			return true;
+		}
+		++misses;
+		hierarchy.build(bounds);
+		pending.push_back(Pending { key, n_bounds, hierarchy });
+		return false;
+	}
+	/// <summary>
+	/// Writes the misses since the last flush on a background thread, then
+	/// evicts the oldest files past the size cap.
+	/// </summary>
+	void HierarchyCache::flush()
+	{
+		if(pending.empty()) { return; }
+		writing = std::async(std::launch::async,
+			[previous = std::move(writing), entries = std::move(pending), path = directory]() mutable
+			{
+				if(previous.valid()) { previous.wait(); }
+				for(Pending const & entry : entries)
+				{
+					store(path, entry);
+				}
+				evict(path);
+			});
+		pending.clear();
+	}
+	/// <summary>
+	/// Waits for the background writes.
+	/// </summary>
+	void HierarchyCache::wait() const
+	{
+		if(writing.valid()) { writing.wait(); }
+	}
+	/// <summary>
+	/// Hash of the mesh primitives, the vertices they index, their indices
+	/// from the first mesh vertex and the builder version, 64 bit FNV-1a.
+	/// </summary>
+	std::uint64_t HierarchyCache::key(std::vector<std::uint32_t> const & mesh,
+		std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices) noexcept
+	{
+		std::uint64_t hash { 0xCBF29CE484222325U };
+		auto const mix = [&hash](void const * data, std::size_t const size)
+		{
+			auto const bytes { static_cast<unsigned char const *>(data) };
+			for(std::size_t i { 0U }; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 0x00000100000001B3U;
+			}
+		};
+		// Vertices a primitive of each type indexes.
+		auto const n_vertices = [](Primitive::Types const type) -> std::uint32_t
+		{
+			switch(type)
+			{
+				case Primitive::Types::Sphere: return 1U;
+				case Primitive::Types::Cuboid: return 2U;
+				case Primitive::Types::Triangle: return 3U;
+				default: return 0U;
+			}
+		};
+		// Indices are taken from the first mesh vertex, so the same mesh
+		// loaded elsewhere in the vertex list has the same key.
+		std::uint32_t first { std::numeric_limits<std::uint32_t>::max() };
+		for(std::uint32_t const primitive_idx : mesh)
+		{
+			Primitive const & primitive { primitives[primitive_idx] };
+			for(std::uint32_t v { 0U }; v < n_vertices(primitive.type); ++v)
+			{
+				first = std::min(first, primitive.vertices[v]);
+			}
+		}
+		mix(&version, sizeof(version));
+		for(std::uint32_t const primitive_idx : mesh)
+		{
+			Primitive const & primitive { primitives[primitive_idx] };
+			mix(&primitive.type, sizeof(primitive.type));
+			mix(&primitive.radius, sizeof(primitive.radius));
+			for(std::uint32_t v { 0U }; v < n_vertices(primitive.type); ++v)
+			{
+				std::uint32_t const index { primitive.vertices[v] - first };
+				mix(&index, sizeof(index));
+				mix(&vertices[primitive.vertices[v]].position, sizeof(glm::vec3));
+			}
+		}
+		return hash;
+	}
+	/// <summary>
+	/// Cache file of the given key.
+	/// </summary>
+	std::filesystem::path HierarchyCache::file(std::filesystem::path const & directory, std::uint64_t const key)
+	{
+		std::ostringstream name {};
+		name << std::hex << std::setw(16) << std::setfill('0') << key << ".bvh";
+		return directory / name.str();
+	}
+	/// <summary>
+	/// Reads a cached hierarchy, checking it matches the given key and number
+	/// of boxes.
+	/// </summary>
+	bool HierarchyCache::load(std::uint64_t const key, std::uint32_t const n_bounds, Hierarchy & hierarchy) const
+	{
+		std::ifstream stream(file(directory, key), std::ios::binary);
+		if(!stream.is_open()) { return false; }
+		Header header {};
+		if(!stream.read(reinterpret_cast<char *>(&header), sizeof(Header))) { return false; }
+		if(header.magic != magic || header.version != version || header.key != key ||
+			header.n_bounds != n_bounds || header.n_nodes == 0U ||
+			header.n_references > static_cast<std::uint64_t>((1.0f + Hierarchy::max_spatial_budget) * n_bounds))
+		{
+			return false;
+		}
+		std::vector<Node> nodes(header.n_nodes);
+		std::vector<std::uint32_t> references(header.n_references);
+		stream.read(reinterpret_cast<char *>(nodes.data()), nodes.size() * sizeof(Node));
+		stream.read(reinterpret_cast<char *>(references.data()), references.size() * sizeof(std::uint32_t));
+		if(!stream) { return false; }
+		// Never hand the device indices out of range.
+		for(std::uint32_t const reference : references)
+		{
+			if(reference >= n_bounds) { return false; }
+		}
+		// Children always follow their parent on a build, which also rules
+		// out cycles.
+		for(std::uint32_t i { 0U }; i < header.n_nodes; ++i)
+		{
+			Node const & node { nodes[i] };
+			if(node.left & Hierarchy::leaf_flag)
+			{
+				std::uint64_t const first { node.left & ~Hierarchy::leaf_flag };
+				if(first + node.right > header.n_references) { return false; }
+			}
+			else if(node.left <= i || node.right <= i ||
+				node.left >= header.n_nodes || node.right >= header.n_nodes)
+			{
+				return false;
+			}
+		}
+		hierarchy.nodes = std::move(nodes);
+		hierarchy.references = std::move(references);
+		hierarchy.build_cost = hierarchy.cost();
+		return true;
+	}
+	/// <summary>
+	/// Writes a hierarchy to the cache. Failures only cost a rebuild on the
+	/// next run, so they are ignored.
+	/// </summary>
+	void HierarchyCache::store(std::filesystem::path const & directory, Pending const & entry)
+	{
+		Hierarchy const & hierarchy { entry.hierarchy };
+		std::error_code error {};
+		std::filesystem::create_directories(directory, error);
+		if(error) { return; }
+		// Written aside and renamed, so readers never see a partial file.
+		std::filesystem::path const path { file(directory, entry.key) };
+		std::filesystem::path temporary { path };
+		temporary += ".tmp";
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			if(!stream.is_open()) { return; }
+			Header const header { magic, version, entry.key, entry.n_bounds,
+				static_cast<std::uint32_t>(hierarchy.nodes.size()),
+				static_cast<std::uint32_t>(hierarchy.references.size()), 0U };
+			stream.write(reinterpret_cast<char const *>(&header), sizeof(Header));
+			stream.write(reinterpret_cast<char const *>(hierarchy.nodes.data()),
+				hierarchy.nodes.size() * sizeof(Node));
+			stream.write(reinterpret_cast<char const *>(hierarchy.references.data()),
+				hierarchy.references.size() * sizeof(std::uint32_t));
+			if(!stream) { stream.close(); std::filesystem::remove(temporary, error); return; }
+		}
+		std::filesystem::rename(temporary, path, error);
+	}
+	/// <summary>
+	/// Removes the least recently used cache files until they fit under the
+	/// size cap. Failures are ignored, like on store.
+	/// </summary>
+	void HierarchyCache::evict(std::filesystem::path const & directory)
+	{
+		std::error_code error {};
+		std::vector<std::tuple<std::filesystem::file_time_type, std::uintmax_t, std::filesystem::path>> files {};
+		std::uintmax_t size { 0U };
+		for(std::filesystem::directory_iterator entry { directory, error }, end {};
+			!error && entry != end; entry.increment(error))
+		{
+			if(entry->path().extension() != ".bvh") { continue; }
+			std::error_code file_error {};
+			std::uintmax_t const file_size { entry->file_size(file_error) };
+			std::filesystem::file_time_type const time { entry->last_write_time(file_error) };
+			if(file_error) { continue; }
+			files.emplace_back(time, file_size, entry->path());
+			size += file_size;
+		}
+		if(size <= max_size) { return; }
+		// Oldest first.
+		std::sort(files.begin(), files.end());
+		for(auto const & [time, file_size, path] : files)
+		{
+			if(size <= max_size) { break; }
+			if(std::filesystem::remove(path, error)) { size -= file_size; }
+		}
+	}
+}
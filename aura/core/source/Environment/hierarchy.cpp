@@ -0,0 +1,954 @@
+// ========================================================================== //
+// File : hierarchy.cpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#include <Aura/Core/Environment/hierarchy.hpp>
+// Internal includes.
+#include <Aura/Core/Environment/hierarchy-cache.hpp>
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+namespace Aura::Core
+{
+	// ------------------------------------------------------------------ //
+	// Construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Rebuilds the hierarchy over the given primitive boxes. Each box index
+	/// is the primitive index, empty boxes are left out.
+	/// </summary>
+	void Hierarchy::build(std::vector<Bounds> const & bounds)
+	{
+		// Build task, a node and the range of references it covers.
+		struct Task
+		{
+			std::uint32_t node;
+			std::uint32_t first;
+			std::uint32_t count;
+			std::uint32_t depth;
+		};
+		nodes.clear();
+		references.clear();
+		build_cost = 0.0f;
+		// Gather non empty primitives and their centroids.
+		std::vector<glm::vec3> centroids(bounds.size());
+		for(std::size_t i { 0U }; i < bounds.size(); ++i)
+		{
+			if(!bounds[i].valid()) { continue; }
+			centroids[i] = bounds[i].centroid();
+			references.emplace_back(static_cast<std::uint32_t>(i));
+		}
+		// An empty hierarchy keeps an empty root leaf, which is never hit.
+		nodes.reserve(references.empty() ? 1U : 2U * references.size() - 1U);
+		nodes.emplace_back();
+		nodes[0U].left = leaf_flag;
+		if(references.empty()) { return; }
+
+		std::vector<Task> tasks {};
+		tasks.emplace_back(Task { 0U, 0U, static_cast<std::uint32_t>(references.size()), 0U });
+		while(!tasks.empty())
+		{
+			Task const task { tasks.back() };
+			tasks.pop_back();
+			// Node and centroid boxes.
+			Bounds node_bounds {}, centroid_bounds {};
+			for(std::uint32_t i { task.first }; i < task.first + task.count; ++i)
+			{
+				node_bounds.grow(bounds[references[i]]);
+				centroid_bounds.grow(centroids[references[i]]);
+			}
+			nodes[task.node].min = node_bounds.min;
+			nodes[task.node].max = node_bounds.max;
+			// Split only if cheaper than a leaf, or if the leaf is too big.
+			std::uint32_t axis { 0U }, split { 0U };
+			float cost { 0.0f };
+			bool const can_split { task.count > 1U && task.depth + 1U < max_depth &&
+				findSplit(references, centroids, bounds, centroid_bounds, node_bounds.area(),
+					task.first, task.count, axis, split, cost) };
+			float const leaf_cost { static_cast<float>(task.count) * intersection_cost };
+			if(!can_split || (task.count <= max_leaf_size && cost >= leaf_cost))
+			{
+				nodes[task.node].left = task.first | leaf_flag;
+				nodes[task.node].right = task.count;
+				continue;
+			}
+			// Partition references by bin, the split has references on both sides.
+			auto const begin { references.begin() + task.first };
+			auto const middle { std::partition(begin, begin + task.count,
+				[&](std::uint32_t const reference)
+				{ return bin(centroids[reference], centroid_bounds, axis) <= split; }) };
+			std::uint32_t const n_left { static_cast<std::uint32_t>(middle - begin) };
+			// Create both children.
+			std::uint32_t const left { static_cast<std::uint32_t>(nodes.size()) };
+			nodes.emplace_back();
+			nodes.emplace_back();
+			nodes[task.node].left = left;
+			nodes[task.node].right = left + 1U;
+			tasks.emplace_back(Task { left + 1U, task.first + n_left, task.count - n_left, task.depth + 1U });
+			tasks.emplace_back(Task { left, task.first, n_left, task.depth + 1U });
+		}
+		build_cost = cost();
+	}
+	/// <summary>
+	/// Rebuilds the hierarchy as a linear hierarchy over the Morton codes of
+	/// the box centroids. Follows the device build step by step, so both
+	/// produce the same layout: internal nodes first, then one leaf per
+	/// primitive in Morton order.
+	/// </summary>
+	void Hierarchy::buildLinear(std::vector<Bounds> const & bounds)
+	{
+		// Sorted Morton code and its primitive.
+		struct Key
+		{
+			std::uint32_t code;
+			std::uint32_t index;
+		};
+		nodes.clear();
+		references.clear();
+		auto const n { static_cast<std::int32_t>(bounds.size()) };
+		if(n == 0)
+		{
+			nodes.emplace_back();
+			nodes[0U].left = leaf_flag;
+			return;
+		}
+		// Quantize centroids over the centroid bounds.
+		Bounds centroid_bounds {};
+		for(Bounds const & box : bounds)
+		{
+			if(box.valid()) { centroid_bounds.grow(box.centroid()); }
+		}
+		glm::vec3 const extent { centroid_bounds.max - centroid_bounds.min };
+		glm::vec3 scale { 0.0f };
+		for(std::uint32_t a { 0U }; a < 3U; ++a)
+		{
+			if(extent[a] > 0.0f) { scale[a] = static_cast<float>(1U << morton_bits) / extent[a]; }
+		}
+		std::vector<Key> keys(bounds.size());
+		for(std::int32_t i { 0 }; i < n; ++i)
+		{
+			keys[i] = Key { empty_code, static_cast<std::uint32_t>(i) };
+			if(!bounds[i].valid()) { continue; }
+			glm::vec3 const q { (bounds[i].centroid() - centroid_bounds.min) * scale };
+			std::uint32_t const max_q { (1U << morton_bits) - 1U };
+			keys[i].code = expand(std::min(static_cast<std::uint32_t>(q.x), max_q)) << 2U |
+				expand(std::min(static_cast<std::uint32_t>(q.y), max_q)) << 1U |
+				expand(std::min(static_cast<std::uint32_t>(q.z), max_q));
+		}
+		std::stable_sort(keys.begin(), keys.end(),
+			[](Key const & a, Key const & b) { return a.code < b.code; });
+		// Common prefix length between sorted keys, equal codes are told apart
+		// by their positions.
+		auto const delta = [&](std::int32_t const i, std::int32_t const j) -> std::int32_t
+		{
+			if(j < 0 || j >= n) { return -1; }
+			if(keys[i].code == keys[j].code)
+			{ return 32 + std::countl_zero(static_cast<std::uint32_t>(i ^ j)); }
+			return std::countl_zero(keys[i].code ^ keys[j].code);
+		};
+		// Leaves and internal nodes (Karras, 2012).
+		std::vector<std::uint32_t> parents(2U * bounds.size() - 1U, 0U);
+		nodes.resize(2U * bounds.size() - 1U);
+		references.resize(bounds.size());
+		for(std::int32_t i { 0 }; i < n; ++i)
+		{
+			nodes[n - 1 + i].left = static_cast<std::uint32_t>(i) | leaf_flag;
+			nodes[n - 1 + i].right = 1U;
+			references[i] = keys[i].index;
+		}
+		for(std::int32_t i { 0 }; i < n - 1; ++i)
+		{
+			std::int32_t const d { delta(i, i + 1) >= delta(i, i - 1) ? 1 : -1 };
+			std::int32_t const d_min { delta(i, i - d) };
+			std::int32_t l_max { 2 };
+			while(delta(i, i + l_max * d) > d_min) { l_max *= 2; }
+			std::int32_t l { 0 };
+			for(std::int32_t t { l_max / 2 }; t >= 1; t /= 2)
+			{
+				if(delta(i, i + (l + t) * d) > d_min) { l += t; }
+			}
+			std::int32_t const j { i + l * d };
+			std::int32_t const d_node { delta(i, j) };
+			std::int32_t s { 0 }, t { l };
+			do
+			{
+				t = (t + 1) / 2;
+				if(delta(i, i + (s + t) * d) > d_node) { s += t; }
+			} while(t > 1);
+			std::int32_t const gamma { i + s * d + std::min(d, 0) };
+			auto const left { static_cast<std::uint32_t>(std::min(i, j) == gamma ? n - 1 + gamma : gamma) };
+			auto const right { static_cast<std::uint32_t>(std::max(i, j) == gamma + 1 ? n + gamma : gamma + 1) };
+			nodes[i].left = left;
+			nodes[i].right = right;
+			parents[left] = static_cast<std::uint32_t>(i);
+			parents[right] = static_cast<std::uint32_t>(i);
+		}
+		// Fit boxes bottom-up, a node is fitted by the second child to arrive.
+		std::vector<std::uint32_t> flags(bounds.size(), 0U);
+		for(std::int32_t i { 0 }; i < n; ++i)
+		{
+			std::uint32_t const leaf { static_cast<std::uint32_t>(n - 1 + i) };
+			nodes[leaf].min = bounds[keys[i].index].min;
+			nodes[leaf].max = bounds[keys[i].index].max;
+			if(leaf == 0U) { break; }
+			std::uint32_t node { parents[leaf] };
+			while(flags[node]++ != 0U)
+			{
+				Node const & left { nodes[nodes[node].left] };
+				Node const & right { nodes[nodes[node].right] };
+				nodes[node].min = glm::min(left.min, right.min);
+				nodes[node].max = glm::max(left.max, right.max);
+				if(node == 0U) { break; }
+				node = parents[node];
+			}
+		}
+	}
+	/// <summary>
+	/// Rebuilds the hierarchy with spatial splits. Where object split children
+	/// overlap, references may also be split by a plane and clipped to each
+	/// side, up to the budget fraction of extra references. Leaves may then
+	/// share primitives.
+	/// </summary>
+	void Hierarchy::buildSpatial(std::vector<Bounds> const & bounds, std::vector<Triangle> const & triangles,
+		float const budget)
+	{
+		// Build task, a node and its references, each with its clipped box.
+		struct Task
+		{
+			std::uint32_t node;
+			std::uint32_t depth;
+			std::vector<std::uint32_t> primitives;
+			std::vector<Bounds> boxes;
+		};
+		nodes.clear();
+		references.clear();
+		build_cost = 0.0f;
+		Task root { 0U, 0U, {}, {} };
+		Bounds root_bounds {};
+		for(std::size_t i { 0U }; i < bounds.size(); ++i)
+		{
+			if(!bounds[i].valid()) { continue; }
+			root.primitives.emplace_back(static_cast<std::uint32_t>(i));
+			root.boxes.emplace_back(bounds[i]);
+			root_bounds.grow(bounds[i]);
+		}
+		nodes.emplace_back();
+		nodes[0U].left = leaf_flag;
+		if(root.primitives.empty()) { return; }
+		float const root_area { root_bounds.area() };
+		// Extra references spatial splits may still add.
+		auto remaining { static_cast<std::uint32_t>(std::clamp(budget, 0.0f, max_spatial_budget) *
+			static_cast<float>(root.primitives.size())) };
+
+		std::vector<Task> tasks {};
+		tasks.emplace_back(std::move(root));
+		while(!tasks.empty())
+		{
+			Task task { std::move(tasks.back()) };
+			tasks.pop_back();
+			auto const count { static_cast<std::uint32_t>(task.primitives.size()) };
+			// Node and centroid boxes, the task references are the split list.
+			Bounds node_bounds {}, centroid_bounds {};
+			std::vector<glm::vec3> centroids(count);
+			std::vector<std::uint32_t> list(count);
+			for(std::uint32_t i { 0U }; i < count; ++i)
+			{
+				centroids[i] = task.boxes[i].centroid();
+				list[i] = i;
+				node_bounds.grow(task.boxes[i]);
+				centroid_bounds.grow(centroids[i]);
+			}
+			nodes[task.node].min = node_bounds.min;
+			nodes[task.node].max = node_bounds.max;
+			bool const can_split { count > 1U && task.depth + 1U < max_depth };
+			// Object split, and the overlap between its children.
+			std::uint32_t axis { 0U }, split { 0U };
+			float object_cost { std::numeric_limits<float>::max() };
+			bool const object_found { can_split && findSplit(list, centroids, task.boxes, centroid_bounds,
+				node_bounds.area(), 0U, count, axis, split, object_cost) };
+			Bounds overlap { node_bounds };
+			if(object_found)
+			{
+				Bounds left {}, right {};
+				for(std::uint32_t i { 0U }; i < count; ++i)
+				{
+					(bin(centroids[i], centroid_bounds, axis) <= split ? left : right).grow(task.boxes[i]);
+				}
+				overlap.min = glm::max(left.min, right.min);
+				overlap.max = glm::min(left.max, right.max);
+			}
+			// Spatial split, only tried where the object split overlaps.
+			std::uint32_t spatial_axis { 0U };
+			float plane { 0.0f }, spatial_cost { std::numeric_limits<float>::max() };
+			bool const spatial_found { can_split && remaining > 0U && root_area > 0.0f &&
+				overlap.area() / root_area > spatial_overlap &&
+				findSpatialSplit(task.boxes, task.primitives, triangles, node_bounds, remaining,
+					spatial_axis, plane, spatial_cost) };
+			// Split only if cheaper than a leaf, or if the leaf is too big.
+			float const leaf_cost { static_cast<float>(count) * intersection_cost };
+			float const cost { std::min(object_cost, spatial_cost) };
+			Task left { static_cast<std::uint32_t>(nodes.size()), task.depth + 1U, {}, {} };
+			Task right { left.node + 1U, task.depth + 1U, {}, {} };
+			if((object_found || spatial_found) && (count > max_leaf_size || cost < leaf_cost))
+			{
+				if(spatial_found && spatial_cost < object_cost)
+				{
+					for(std::uint32_t i { 0U }; i < count; ++i)
+					{
+						Bounds const & box { task.boxes[i] };
+						std::uint32_t const primitive { task.primitives[i] };
+						if(box.max[spatial_axis] <= plane)
+						{
+							left.primitives.emplace_back(primitive);
+							left.boxes.emplace_back(box);
+							continue;
+						}
+						if(box.min[spatial_axis] >= plane)
+						{
+							right.primitives.emplace_back(primitive);
+							right.boxes.emplace_back(box);
+							continue;
+						}
+						// Straddling references are clipped to both sides, the
+						// triangle may miss one of them.
+						Triangle const & triangle { primitive < triangles.size() ? triangles[primitive] : Triangle {} };
+						Bounds const left_box { clip(box, triangle, spatial_axis, box.min[spatial_axis], plane) };
+						Bounds const right_box { clip(box, triangle, spatial_axis, plane, box.max[spatial_axis]) };
+						if(left_box.valid())
+						{
+							left.primitives.emplace_back(primitive);
+							left.boxes.emplace_back(left_box);
+						}
+						if(right_box.valid())
+						{
+							right.primitives.emplace_back(primitive);
+							right.boxes.emplace_back(right_box);
+						}
+						if(!left_box.valid() && !right_box.valid())
+						{
+							left.primitives.emplace_back(primitive);
+							left.boxes.emplace_back(box);
+						}
+					}
+					std::uint32_t const added { static_cast<std::uint32_t>(
+						left.primitives.size() + right.primitives.size()) - count };
+					// The search only takes planes within the budget, a plane
+					// past it through rounding falls back to the object split.
+					if(added > remaining)
+					{
+						left.primitives.clear();
+						right.primitives.clear();
+					}
+					else
+					{
+						remaining -= added;
+					}
+				}
+				// Object splits, and spatial splits that left a side empty.
+				if(left.primitives.empty() || right.primitives.empty())
+				{
+					left.primitives.clear();
+					left.boxes.clear();
+					right.primitives.clear();
+					right.boxes.clear();
+					if(object_found)
+					{
+						for(std::uint32_t i { 0U }; i < count; ++i)
+						{
+							Task & side { bin(centroids[i], centroid_bounds, axis) <= split ? left : right };
+							side.primitives.emplace_back(task.primitives[i]);
+							side.boxes.emplace_back(task.boxes[i]);
+						}
+					}
+				}
+			}
+			if(left.primitives.empty() || right.primitives.empty())
+			{
+				nodes[task.node].left = static_cast<std::uint32_t>(references.size()) | leaf_flag;
+				nodes[task.node].right = count;
+				references.insert(references.end(), task.primitives.begin(), task.primitives.end());
+				continue;
+			}
+			nodes.emplace_back();
+			nodes.emplace_back();
+			nodes[task.node].left = left.node;
+			nodes[task.node].right = right.node;
+			tasks.emplace_back(std::move(right));
+			tasks.emplace_back(std::move(left));
+		}
+		build_cost = cost();
+	}
+	/// <summary>
+	/// Fits every node box to the given primitive boxes, keeping the topology.
+	/// Only valid for a build, where children always follow their parent.
+	/// Returns the cost ratio against the last build.
+	/// </summary>
+	float Hierarchy::refit(std::vector<Bounds> const & bounds)
+	{
+		for(std::size_t i { nodes.size() }; i-- > 0U;)
+		{
+			Node & node { nodes[i] };
+			Bounds box {};
+			if(node.left & leaf_flag)
+			{
+				std::uint32_t const first { node.left & ~leaf_flag };
+				for(std::uint32_t r { first }; r < first + node.right; ++r)
+				{
+					box.grow(bounds[references[r]]);
+				}
+			}
+			else
+			{
+				box.grow(Bounds { nodes[node.left].min, nodes[node.left].max });
+				box.grow(Bounds { nodes[node.right].min, nodes[node.right].max });
+			}
+			node.min = box.min;
+			node.max = box.max;
+		}
+		return build_cost > 0.0f ? cost() / build_cost : 1.0f;
+	}
+	/// <summary>
+	/// Surface area heuristic cost of the hierarchy, relative to the root
+	/// area.
+	/// </summary>
+	float Hierarchy::cost() const noexcept
+	{
+		if(nodes.empty()) { return 0.0f; }
+		float const root_area { Bounds { nodes[0U].min, nodes[0U].max }.area() };
+		if(root_area <= 0.0f) { return 0.0f; }
+		float total { 0.0f };
+		for(Node const & node : nodes)
+		{
+			float const area { Bounds { node.min, node.max }.area() };
+			if(node.left & leaf_flag)
+			{ total += area * static_cast<float>(node.right) * intersection_cost; }
+			else
+			{ total += area * traversal_cost; }
+		}
+		return total / root_area;
+	}
+	/// <summary>
+	/// Calculates the world space box of a primitive, applying its transform
+	/// the same way the vertex stage does.
+	/// </summary>
+	Bounds Hierarchy::primitiveBounds(Primitive const & primitive,
+		std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms)
+	{
+		Bounds bounds {};
+		Transform const & transform { transforms[primitive.transform_idx] };
+		switch(primitive.type)
+		{
+		case Primitive::Types::Sphere:
+		{
+			glm::mat4 const trf { transform.translation * transform.rotation };
+			glm::vec3 const centre { trf * glm::vec4(vertices[primitive.vertices.x].position, 1.0f) };
+			glm::vec4 const r_tmp { transform.scaling *
+				glm::vec4(primitive.radius, primitive.radius, primitive.radius, 1.0f) };
+			glm::vec3 const radius { (r_tmp.x + r_tmp.y + r_tmp.z) / 3.0f };
+			bounds.grow(centre - radius);
+			bounds.grow(centre + radius);
+			break;
+		}
+		case Primitive::Types::Cuboid:
+		{
+			// Oriented box, bounded by all of its corners.
+			glm::mat4 const trf { transform.translation * transform.rotation * transform.scaling };
+			glm::vec3 const & v0 { vertices[primitive.vertices.x].position };
+			glm::vec3 const & v1 { vertices[primitive.vertices.y].position };
+			for(std::uint32_t corner { 0U }; corner < 8U; ++corner)
+			{
+				glm::vec3 const p { corner & 1U ? v1.x : v0.x, corner & 2U ? v1.y : v0.y, corner & 4U ? v1.z : v0.z };
+				bounds.grow(glm::vec3(trf * glm::vec4(p, 1.0f)));
+			}
+			break;
+		}
+		case Primitive::Types::Triangle:
+		{
+			glm::mat4 const trf { transform.translation * transform.rotation * transform.scaling };
+			bounds.grow(glm::vec3(trf * glm::vec4(vertices[primitive.vertices.x].position, 1.0f)));
+			bounds.grow(glm::vec3(trf * glm::vec4(vertices[primitive.vertices.y].position, 1.0f)));
+			bounds.grow(glm::vec3(trf * glm::vec4(vertices[primitive.vertices.z].position, 1.0f)));
+			break;
+		}
+		default:
+			break;
+		}
+		return bounds;
+	}
+	/// <summary>
+	/// Calculates the object space box of a primitive, ignoring its
+	/// transform.
+	/// </summary>
+	Bounds Hierarchy::primitiveBounds(Primitive const & primitive, std::vector<Vertex> const & vertices)
+	{
+		Bounds bounds {};
+		switch(primitive.type)
+		{
+		case Primitive::Types::Sphere:
+		{
+			glm::vec3 const & centre { vertices[primitive.vertices.x].position };
+			bounds.grow(centre - glm::vec3(primitive.radius));
+			bounds.grow(centre + glm::vec3(primitive.radius));
+			break;
+		}
+		case Primitive::Types::Cuboid:
+			bounds.grow(vertices[primitive.vertices.x].position);
+			bounds.grow(vertices[primitive.vertices.y].position);
+			break;
+		case Primitive::Types::Triangle:
+			bounds.grow(vertices[primitive.vertices.x].position);
+			bounds.grow(vertices[primitive.vertices.y].position);
+			bounds.grow(vertices[primitive.vertices.z].position);
+			break;
+		default:
+			break;
+		}
+		return bounds;
+	}
+	/// <summary>
+	/// World space triangle of a primitive, invalid for other types.
+	/// </summary>
+	Triangle Hierarchy::primitiveTriangle(Primitive const & primitive,
+		std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms)
+	{
+		Triangle triangle {};
+		if(primitive.type != Primitive::Types::Triangle) { return triangle; }
+		Transform const & transform { transforms[primitive.transform_idx] };
+		glm::mat4 const trf { transform.translation * transform.rotation * transform.scaling };
+		triangle.v0 = glm::vec3(trf * glm::vec4(vertices[primitive.vertices.x].position, 1.0f));
+		triangle.v1 = glm::vec3(trf * glm::vec4(vertices[primitive.vertices.y].position, 1.0f));
+		triangle.v2 = glm::vec3(trf * glm::vec4(vertices[primitive.vertices.z].position, 1.0f));
+		triangle.valid = true;
+		return triangle;
+	}
+	/// <summary>
+	/// Searches the best binned split of the list range. Returns whenever a
+	/// valid split was found and updates the axis, the last left bin and the
+	/// split cost.
+	/// </summary>
+	bool Hierarchy::findSplit(std::vector<std::uint32_t> const & list,
+		std::vector<glm::vec3> const & centroids, std::vector<Bounds> const & bounds,
+		Bounds const & centroid_bounds, float const parent_area,
+		std::uint32_t const first, std::uint32_t const count,
+		std::uint32_t & axis, std::uint32_t & split, float & cost)
+	{
+		bool found { false };
+		cost = std::numeric_limits<float>::max();
+		if(parent_area <= 0.0f) { return false; }
+		for(std::uint32_t a { 0U }; a < 3U; ++a)
+		{
+			if(centroid_bounds.max[a] <= centroid_bounds.min[a]) { continue; }
+			// Fill bins.
+			std::array<Bounds, n_bins> bin_bounds {};
+			std::array<std::uint32_t, n_bins> bin_counts {};
+			for(std::uint32_t i { first }; i < first + count; ++i)
+			{
+				std::uint32_t const reference { list[i] };
+				std::uint32_t const b { bin(centroids[reference], centroid_bounds, a) };
+				bin_bounds[b].grow(bounds[reference]);
+				++bin_counts[b];
+			}
+			// Sweep from the right to get the right side of every plane.
+			std::array<float, n_bins> right_areas {};
+			std::array<std::uint32_t, n_bins> right_counts {};
+			Bounds right {};
+			std::uint32_t n_right { 0U };
+			for(std::uint32_t b { n_bins - 1U }; b > 0U; --b)
+			{
+				right.grow(bin_bounds[b]);
+				n_right += bin_counts[b];
+				right_areas[b] = right.area();
+				right_counts[b] = n_right;
+			}
+			// Sweep from the left evaluating each plane.
+			Bounds left {};
+			std::uint32_t n_left { 0U };
+			for(std::uint32_t b { 0U }; b < n_bins - 1U; ++b)
+			{
+				left.grow(bin_bounds[b]);
+				n_left += bin_counts[b];
+				if(n_left == 0U || right_counts[b + 1U] == 0U) { continue; }
+				float const plane_cost { traversal_cost + intersection_cost *
+					(left.area() * static_cast<float>(n_left) +
+					right_areas[b + 1U] * static_cast<float>(right_counts[b + 1U])) / parent_area };
+				if(plane_cost < cost)
+				{
+					cost = plane_cost;
+					axis = a;
+					split = b;
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+	/// <summary>
+	/// Searches the best binned spatial split of the given boxes, each clipped
+	/// to every bin it spans. Planes straddled by more references than the
+	/// remaining budget are left out, as each straddling reference is split
+	/// in two. Returns whenever a valid split was found and updates the axis,
+	/// the plane and the split cost.
+	/// </summary>
+	bool Hierarchy::findSpatialSplit(std::vector<Bounds> const & boxes,
+		std::vector<std::uint32_t> const & primitives, std::vector<Triangle> const & triangles,
+		Bounds const & node_bounds, std::uint32_t const remaining,
+		std::uint32_t & axis, float & plane, float & cost)
+	{
+		bool found { false };
+		cost = std::numeric_limits<float>::max();
+		float const parent_area { node_bounds.area() };
+		if(parent_area <= 0.0f) { return false; }
+		for(std::uint32_t a { 0U }; a < 3U; ++a)
+		{
+			float const origin { node_bounds.min[a] };
+			float const width { (node_bounds.max[a] - origin) / static_cast<float>(n_bins) };
+			if(width <= 0.0f) { continue; }
+			// Fill bins, counting where each reference enters and exits.
+			std::array<Bounds, n_bins> bin_bounds {};
+			std::array<std::uint32_t, n_bins> entries {};
+			std::array<std::uint32_t, n_bins> exits {};
+			auto const bin_of = [&](float const x)
+			{
+				auto const b { static_cast<std::int32_t>((x - origin) / width) };
+				return static_cast<std::uint32_t>(std::clamp(b, 0, static_cast<std::int32_t>(n_bins) - 1));
+			};
+			for(std::size_t i { 0U }; i < boxes.size(); ++i)
+			{
+				Triangle const & triangle { primitives[i] < triangles.size() ? triangles[primitives[i]] : Triangle {} };
+				std::uint32_t const first { bin_of(boxes[i].min[a]) };
+				std::uint32_t const last { bin_of(boxes[i].max[a]) };
+				for(std::uint32_t b { first }; b <= last; ++b)
+				{
+					float const lo { origin + static_cast<float>(b) * width };
+					float const hi { b == n_bins - 1U ? node_bounds.max[a] : lo + width };
+					bin_bounds[b].grow(clip(boxes[i], triangle, a, lo, hi));
+				}
+				++entries[first];
+				++exits[last];
+			}
+			// Sweep from the right to get the right side of every plane.
+			std::array<float, n_bins> right_areas {};
+			std::array<std::uint32_t, n_bins> right_counts {};
+			Bounds right {};
+			std::uint32_t n_right { 0U };
+			for(std::uint32_t b { n_bins - 1U }; b > 0U; --b)
+			{
+				right.grow(bin_bounds[b]);
+				n_right += exits[b];
+				right_areas[b] = right.area();
+				right_counts[b] = n_right;
+			}
+			// Sweep from the left evaluating each plane. References entered
+			// and not yet exited straddle the plane.
+			Bounds left {};
+			std::uint32_t n_left { 0U }, n_exited { 0U };
+			for(std::uint32_t b { 0U }; b < n_bins - 1U; ++b)
+			{
+				left.grow(bin_bounds[b]);
+				n_left += entries[b];
+				n_exited += exits[b];
+				if(n_left == 0U || right_counts[b + 1U] == 0U || n_left - n_exited > remaining) { continue; }
+				float const plane_cost { traversal_cost + intersection_cost *
+					(left.area() * static_cast<float>(n_left) +
+					right_areas[b + 1U] * static_cast<float>(right_counts[b + 1U])) / parent_area };
+				if(plane_cost < cost)
+				{
+					cost = plane_cost;
+					axis = a;
+					plane = origin + static_cast<float>(b + 1U) * width;
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+	/// <summary>
+	/// Clips a reference box to the slab between both planes along the axis,
+	/// tightened to the triangle part inside the slab.
+	/// </summary>
+	Bounds Hierarchy::clip(Bounds const & box, Triangle const & triangle,
+		std::uint32_t const axis, float const lo, float const hi) noexcept
+	{
+		Bounds slab { box };
+		slab.min[axis] = std::max(slab.min[axis], lo);
+		slab.max[axis] = std::min(slab.max[axis], hi);
+		if(!slab.valid() || !triangle.valid) { return slab; }
+		// Vertices inside the slab and edge crossings of both planes.
+		std::array<glm::vec3, 3U> const vertices { triangle.v0, triangle.v1, triangle.v2 };
+		Bounds clipped {};
+		for(std::uint32_t e { 0U }; e < 3U; ++e)
+		{
+			glm::vec3 const & v0 { vertices[e] };
+			glm::vec3 const & v1 { vertices[(e + 1U) % 3U] };
+			if(v0[axis] >= lo && v0[axis] <= hi) { clipped.grow(v0); }
+			for(float const p : { lo, hi })
+			{
+				if((v0[axis] < p) == (v1[axis] < p)) { continue; }
+				glm::vec3 point { v0 + (v1 - v0) * ((p - v0[axis]) / (v1[axis] - v0[axis])) };
+				point[axis] = p;
+				clipped.grow(point);
+			}
+		}
+		// References may already be clipped, stay within their box.
+		clipped.min = glm::max(clipped.min, slab.min);
+		clipped.max = glm::min(clipped.max, slab.max);
+		return clipped;
+	}
+	/// <summary>
+	/// Spreads the lower 10 bits so there are two zero bits between each.
+	/// </summary>
+	std::uint32_t Hierarchy::expand(std::uint32_t v) noexcept
+	{
+		v = (v * 0x00010001U) & 0xFF0000FFU;
+		v = (v * 0x00000101U) & 0x0F00F00FU;
+		v = (v * 0x00000011U) & 0xC30C30C3U;
+		v = (v * 0x00000005U) & 0x49249249U;
+		return v;
+	}
+	/// <summary>
+	/// Calculates the bin of a centroid along the given axis.
+	/// </summary>
+	std::uint32_t Hierarchy::bin(glm::vec3 const & centroid, Bounds const & centroid_bounds,
+		std::uint32_t const axis) noexcept
+	{
+		float const extent { centroid_bounds.max[axis] - centroid_bounds.min[axis] };
+		float const scale { static_cast<float>(n_bins) / extent };
+		auto const b { static_cast<std::uint32_t>((centroid[axis] - centroid_bounds.min[axis]) * scale) };
+		return std::min(b, n_bins - 1U);
+	}
+
+	// ------------------------------------------------------------------ //
+	// Wide construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Rebuilds the wide hierarchy from a binary hierarchy.
+	/// </summary>
+	void WideHierarchy::build(Hierarchy const & binary)
+	{
+		nodes.clear();
+		nodes.emplace_back();
+		Child const root { child(binary, 0U) };
+		// Small leaf roots sit alone on the root, empty roots are left empty.
+		if(!interior(root))
+		{
+			if(root.count != 0U) { encode(0U, { root }); }
+			return;
+		}
+		std::vector<std::pair<std::uint32_t, Child>> tasks { { 0U, root } };
+		while(!tasks.empty())
+		{
+			auto const [node, task] { tasks.back() };
+			tasks.pop_back();
+			for(auto const & created : encode(node, open(binary, task)))
+			{
+				tasks.emplace_back(created);
+			}
+		}
+	}
+	/// <summary>
+	/// Opens an interior child into the children of its wide node.
+	/// </summary>
+	std::vector<WideHierarchy::Child> WideHierarchy::open(Hierarchy const & binary, Child const & parent)
+	{
+		std::vector<Child> children {};
+		if(parent.node == empty_child)
+		{
+			// Oversized leaves are split evenly, chunks still too big open again.
+			std::uint32_t const chunk { (parent.count + width - 1U) / width };
+			for(std::uint32_t first { parent.first }; first < parent.first + parent.count; first += chunk)
+			{
+				std::uint32_t const count { std::min(chunk, parent.first + parent.count - first) };
+				children.emplace_back(Child { parent.box, empty_child, first, count });
+			}
+			return children;
+		}
+		children.emplace_back(child(binary, binary.nodes[parent.node].left));
+		children.emplace_back(child(binary, binary.nodes[parent.node].right));
+		// Replace the largest binary interior child by its own children.
+		while(children.size() < width)
+		{
+			auto largest { children.end() };
+			for(auto it { children.begin() }; it != children.end(); ++it)
+			{
+				if(it->node == empty_child) { continue; }
+				if(largest == children.end() || it->box.area() > largest->box.area()) { largest = it; }
+			}
+			if(largest == children.end()) { break; }
+			Node const & opened { binary.nodes[largest->node] };
+			*largest = child(binary, opened.left);
+			children.emplace_back(child(binary, opened.right));
+		}
+		return children;
+	}
+	/// <summary>
+	/// Binary node as a child, leaves become reference ranges.
+	/// </summary>
+	WideHierarchy::Child WideHierarchy::child(Hierarchy const & binary, std::uint32_t const node) noexcept
+	{
+		Node const & n { binary.nodes[node] };
+		if(n.left & Hierarchy::leaf_flag)
+		{
+			return Child { Bounds { n.min, n.max }, empty_child, n.left & ~Hierarchy::leaf_flag, n.right };
+		}
+		return Child { Bounds { n.min, n.max }, node, 0U, 0U };
+	}
+	/// <summary>
+	/// Stores the children quantized boxes on the node, creating wide nodes
+	/// for the interior children. Returns the new nodes paired with their
+	/// children.
+	/// </summary>
+	std::vector<std::pair<std::uint32_t, WideHierarchy::Child>> WideHierarchy::encode(
+		std::uint32_t const node, std::vector<Child> const & children)
+	{
+		std::vector<std::pair<std::uint32_t, Child>> created {};
+		Bounds box {};
+		for(Child const & c : children) { box.grow(c.box); }
+		WideNode wide {};
+		wide.origin = box.min;
+		// Smallest power of two step that covers the box in 255 steps.
+		glm::vec3 step {};
+		for(std::uint32_t a { 0U }; a < 3U; ++a)
+		{
+			int exponent { 0 };
+			std::frexp((box.max[a] - box.min[a]) / 255.0f, &exponent);
+			exponent = std::clamp(exponent, -126, 127);
+			step[a] = std::ldexp(1.0f, exponent);
+			wide.exponents |= static_cast<std::uint32_t>(exponent + 127) << (8U * a);
+		}
+		for(std::uint32_t i { 0U }; i < children.size(); ++i)
+		{
+			Child const & c { children[i] };
+			std::uint32_t const shift { 8U * i };
+			// Round outwards, then fix any float rounding so the decoded box
+			// always contains the child.
+			for(std::uint32_t a { 0U }; a < 3U; ++a)
+			{
+				auto lo { static_cast<std::uint32_t>(std::clamp(
+					std::floor((c.box.min[a] - wide.origin[a]) / step[a]), 0.0f, 255.0f)) };
+				auto hi { static_cast<std::uint32_t>(std::clamp(
+					std::ceil((c.box.max[a] - wide.origin[a]) / step[a]), 0.0f, 255.0f)) };
+				while(lo > 0U && wide.origin[a] + static_cast<float>(lo) * step[a] > c.box.min[a]) { --lo; }
+				while(hi < 255U && wide.origin[a] + static_cast<float>(hi) * step[a] < c.box.max[a]) { ++hi; }
+				glm::uvec4 & planes { a < 2U ? wide.bounds_xy : wide.bounds_z };
+				std::uint32_t const lane { a == 1U ? 2U : 0U };
+				planes[lane] |= lo << shift;
+				planes[lane + 1U] |= hi << shift;
+			}
+			if(interior(c))
+			{
+				wide.children[i] = static_cast<std::uint32_t>(nodes.size());
+				nodes.emplace_back();
+				created.emplace_back(wide.children[i], c);
+			}
+			else
+			{
+				wide.children[i] = c.first | Hierarchy::leaf_flag;
+				wide.bounds_z[2U] |= c.count << shift;
+			}
+		}
+		nodes[node] = wide;
+		return created;
+	}
+
+	// ------------------------------------------------------------------ //
+	// Two level construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Rebuilds every entity bottom level hierarchy and flattens them after
+	/// the top level region. Bottom levels are looked up in the cache first.
+	/// The top level must be rebuilt after.
+	/// </summary>
+	void TwoLevelHierarchy::buildBottom(std::vector<Entity> const & entities,
+		std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices,
+		HierarchyCache & cache)
+	{
+		bottom.resize(entities.size());
+		instances.resize(entities.size());
+		nodes.resize(top_nodes);
+		references.resize(top_references);
+		for(std::size_t e { 0U }; e < entities.size(); ++e)
+		{
+			// Instances are given their source root after.
+			if(mesh(entities, e) != e)
+			{
+				bottom[e] = Hierarchy {};
+				continue;
+			}
+			std::vector<std::uint32_t> const & entity_primitives { entities[e].primitives };
+			std::vector<Bounds> bounds(entity_primitives.size());
+			for(std::size_t i { 0U }; i < entity_primitives.size(); ++i)
+			{
+				bounds[i] = Hierarchy::primitiveBounds(primitives[entity_primitives[i]], vertices);
+			}
+			cache.build(HierarchyCache::key(entity_primitives, primitives, vertices), bounds, bottom[e]);
+			// Move nodes and references to their flattened positions.
+			std::uint32_t const node_offset { static_cast<std::uint32_t>(nodes.size()) };
+			std::uint32_t const reference_offset { static_cast<std::uint32_t>(references.size()) };
+			for(Node node : bottom[e].nodes)
+			{
+				if(node.left & Hierarchy::leaf_flag)
+				{
+					node.left += reference_offset;
+				}
+				else
+				{
+					node.left += node_offset;
+					node.right += node_offset;
+				}
+				nodes.emplace_back(node);
+			}
+			for(std::uint32_t const reference : bottom[e].references)
+			{
+				references.emplace_back(entity_primitives[reference]);
+			}
+			instances[e].root = node_offset;
+		}
+		for(std::size_t e { 0U }; e < entities.size(); ++e)
+		{
+			instances[e].root = instances[mesh(entities, e)].root;
+		}
+		// Misses are written out in the background.
+		cache.flush();
+	}
+	/// <summary>
+	/// Rebuilds the instances and the top level hierarchy over the current
+	/// bottom levels.
+	/// </summary>
+	void TwoLevelHierarchy::buildTop(std::vector<Entity> const & entities, std::vector<Transform> const & transforms)
+	{
+		std::vector<Bounds> bounds(entities.size());
+		for(std::size_t e { 0U }; e < entities.size(); ++e)
+		{
+			glm::mat4 const trf { entityTransform(transforms[entities[e].transform_idx]) };
+			instances[e].world_to_object = glm::inverse(trf);
+			instances[e].material_idx = entities[e].material_idx;
+			// Transform every corner of the bottom level root box.
+			Node const & root { bottom[mesh(entities, e)].nodes[0U] };
+			if(!Bounds { root.min, root.max }.valid()) { continue; }
+			for(std::uint32_t c { 0U }; c < 8U; ++c)
+			{
+				glm::vec3 const corner {
+					c & 1U ? root.max.x : root.min.x,
+					c & 2U ? root.max.y : root.min.y,
+					c & 4U ? root.max.z : root.min.z };
+				bounds[e].grow(glm::vec3(trf * glm::vec4(corner, 1.0f)));
+			}
+		}
+		top.build(bounds);
+		std::copy(top.nodes.begin(), top.nodes.end(), nodes.begin());
+		std::copy(top.references.begin(), top.references.end(), references.begin());
+	}
+}
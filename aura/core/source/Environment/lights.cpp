@@ -0,0 +1,138 @@
+// ========================================================================== //
+// File : lights.cpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#include <Aura/Core/Environment/lights.hpp>
+// Internal includes.
+#include <Aura/Core/Environment/structures.hpp>
+#include <Aura/Core/settings.hpp>
+// Standard includes.
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+namespace Aura::Core
+{
+	// ------------------------------------------------------------------ //
+	// Construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Rebuilds the lights from the emissive primitives of every entity,
+	/// moved to world space by their transform. Instances add the lights
+	/// of their source, with their own transform and material. Throws past
+	/// the lights limit, as the shaders weight every emissive hit as a
+	/// light of the list.
+	/// </summary>
+	void LightList::build(std::vector<Entity> const & entities, std::vector<Primitive> const & primitives,
+		std::vector<Vertex> const & vertices, std::vector<Transform> const & transforms,
+		std::vector<Material> const & materials)
+	{
+		constexpr float pi = static_cast<float>(3.141592653589793);
+		// Corners of each cuboid face, in order around it. Corner bits select
+		// the maximum along x, y and z.
+		constexpr std::array<std::array<std::uint32_t, 4U>, 6U> faces { {
+			{ 0U, 2U, 6U, 4U }, { 1U, 3U, 7U, 5U },
+			{ 0U, 1U, 5U, 4U }, { 2U, 3U, 7U, 6U },
+			{ 0U, 1U, 3U, 2U }, { 4U, 5U, 7U, 6U } } };
+
+		records.clear();
+		area = 0.0f;
+		for(Entity const & entity : entities)
+		{
+			bool const instance { entity.source_idx != Entity::no_source };
+			Entity const & mesh { instance ? entities[entity.source_idx] : entity };
+			// Owned primitives share the entity transform.
+			Transform const & transform { transforms[entity.transform_idx] };
+			glm::mat4 const trf { transform.translation * transform.rotation * transform.scaling };
+			for(std::uint32_t const primitive_idx : mesh.primitives)
+			{
+				Primitive const & primitive { primitives[primitive_idx] };
+				std::uint32_t const material_idx { instance ? entity.material_idx : primitive.material_idx };
+				if(material_idx >= materials.size() || materials[material_idx].type != Material::Types::Emissive)
+				{
+					continue;
+				}
+				switch(primitive.type)
+				{
+					case Primitive::Types::Sphere:
+					{
+						// Spheres keep their shape, the same way the vertex stage
+						// scales them.
+						if(records.size() >= EnvLimits::limit_lights)
+						{
+							throw std::exception("Emissive surfaces past the lights limit. [Light list]");
+						}
+						glm::vec4 const r_tmp { transform.scaling *
+							glm::vec4(primitive.radius, primitive.radius, primitive.radius, 1.0f) };
+						float const radius { (r_tmp.x + r_tmp.y + r_tmp.z) / 3.0f };
+						if(radius <= 0.0f) { break; }
+						LightRecord & light { records.emplace_back() };
+						light.v0 = glm::vec3(transform.translation * transform.rotation *
+							glm::vec4(vertices[primitive.vertices.x].position, 1.0f));
+						light.type = Primitive::Types::Sphere;
+						light.radius = radius;
+						light.material_idx = material_idx;
+						light.area = 4.0f * pi * radius * radius;
+						area += light.area;
+						break;
+					}
+					case Primitive::Types::Cuboid:
+					{
+						glm::vec3 const & v0 { vertices[primitive.vertices.x].position };
+						glm::vec3 const & v1 { vertices[primitive.vertices.y].position };
+						std::array<glm::vec3, 8U> corners {};
+						for(std::uint32_t c { 0U }; c < 8U; ++c)
+						{
+							glm::vec3 const p { c & 1U ? v1.x : v0.x, c & 2U ? v1.y : v0.y, c & 4U ? v1.z : v0.z };
+							corners[c] = glm::vec3(trf * glm::vec4(p, 1.0f));
+						}
+						for(std::array<std::uint32_t, 4U> const & face : faces)
+						{
+							addTriangle(corners[face[0U]], corners[face[1U]], corners[face[2U]], material_idx);
+							addTriangle(corners[face[0U]], corners[face[2U]], corners[face[3U]], material_idx);
+						}
+						break;
+					}
+					case Primitive::Types::Triangle:
+						addTriangle(glm::vec3(trf * glm::vec4(vertices[primitive.vertices.x].position, 1.0f)),
+							glm::vec3(trf * glm::vec4(vertices[primitive.vertices.y].position, 1.0f)),
+							glm::vec3(trf * glm::vec4(vertices[primitive.vertices.z].position, 1.0f)),
+							material_idx);
+						break;
+					default:
+						break;
+				}
+			}
+		}
+		// Cumulative areas, the last light always closes the distribution.
+		float sum { 0.0f };
+		for(LightRecord & light : records)
+		{
+			sum += light.area;
+			light.cdf = sum / area;
+		}
+		if(!records.empty()) { records.back().cdf = 1.0f; }
+	}
+	/// <summary>
+	/// Adds a triangle light, unless it has no area.
+	/// </summary>
+	void LightList::addTriangle(glm::vec3 const & v0, glm::vec3 const & v1, glm::vec3 const & v2,
+		std::uint32_t const material_idx)
+	{
+		float const light_area { 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0)) };
+		if(light_area <= 0.0f) { return; }
+		if(records.size() >= EnvLimits::limit_lights)
+		{
+			throw std::exception("Emissive surfaces past the lights limit. [Light list]");
+		}
+		records.push_back({ v0, Primitive::Types::Triangle, v1, 0.0f, v2, material_idx, light_area });
+		area += light_area;
+	}
+}
@@ -0,0 +1,79 @@
+// ========================================================================== //
+// File : streams.cpp
+//
+// Author : Miguel Ângelo Crespo Ferreira
+// ========================================================================== //
+#include <Aura/Core/Environment/streams.hpp>
+// Internal includes.
+#include <Aura/Core/Environment/structures.hpp>
+// Standard includes.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+// External includes.
+#pragma warning(disable : 26812)
+#include <glm/glm.hpp>
+#pragma warning(default : 26812)
+
+namespace Aura::Core
+{
+	// ------------------------------------------------------------------ //
+	// Construction.
+	// ------------------------------------------------------------------ //
+	/// <summary>
+	/// Rebuilds the streams from the primitives, without transforms.
+	/// Primitives keep their order inside each stream.
+	/// </summary>
+	void PrimitiveStreams::build(std::vector<Primitive> const & primitives, std::vector<Vertex> const & vertices)
+	{
+		spheres.clear();
+		cuboids.clear();
+		triangles.clear();
+		references.assign(primitives.size(), reference(Primitive::Types::Empty, 0U));
+		for(std::size_t i { 0U }; i < primitives.size(); ++i)
+		{
+			Primitive const & primitive { primitives[i] };
+			switch(primitive.type)
+			{
+				case Primitive::Types::Sphere:
+					references[i] = reference(primitive.type, static_cast<std::uint32_t>(spheres.size()));
+					spheres.push_back({ vertices[primitive.vertices.x].position,
+						primitive.radius, primitive.material_idx });
+					break;
+				case Primitive::Types::Cuboid:
+					references[i] = reference(primitive.type, static_cast<std::uint32_t>(cuboids.size()));
+					cuboids.emplace_back();
+					cuboids.back().min = vertices[primitive.vertices.x].position;
+					cuboids.back().material_idx = primitive.material_idx;
+					cuboids.back().max = vertices[primitive.vertices.y].position;
+					break;
+				case Primitive::Types::Triangle:
+				{
+					glm::vec3 const v0 { vertices[primitive.vertices.x].position };
+					glm::vec3 const v1 { vertices[primitive.vertices.y].position };
+					glm::vec3 const v2 { vertices[primitive.vertices.z].position };
+					references[i] = reference(primitive.type, static_cast<std::uint32_t>(triangles.size()));
+					triangles.push_back({ v0, primitive.material_idx, v1, 0U, v2, 0U,
+						glm::cross(v1 - v0, v2 - v0) });
+					break;
+				}
+				default:
+					break;
+			}
+		}
+	}
+	/// <summary>
+	/// Copies the given primitive indices as stream references. Entries
+	/// before first are left as they are.
+	/// </summary>
+	std::vector<std::uint32_t> PrimitiveStreams::encode(std::vector<std::uint32_t> const & indices,
+		std::size_t const first) const
+	{
+		std::vector<std::uint32_t> encoded { indices };
+		for(std::size_t i { first }; i < encoded.size(); ++i)
+		{
+			encoded[i] = references[encoded[i]];
+		}
+		return encoded;
+	}
+}
@@ -271,6 +271,26 @@ namespace Aura::Core
 		{
 			device.destroyPipeline(pipeline, nullptr, dispatch);
 		}
+		/// <summary>
+		/// Creates a query pool with the given type and number of queries.
+		/// Throws any error that might occur.
+		/// </summary>
+		void createQueryPool(vk::QueryPoolCreateFlags const & flags, vk::QueryType const & type,
+			std::uint32_t const & n_queries, vk::QueryPool & query_pool) const
+		{
+			vk::QueryPoolCreateInfo const create_info { flags, type, n_queries, {} };
+			vk::Result const result { device.createQueryPool(
+				&create_info, nullptr, &query_pool, dispatch) };
+			if(result != vk::Result::eSuccess)
+			{ vk::throwResultException(result, "createQueryPool"); }
+		}
+		/// <summary>
+		/// Destroys a query pool.
+		/// </summary>
+		void destroyQueryPool(vk::QueryPool & query_pool) const noexcept
+		{
+			device.destroyQueryPool(query_pool, nullptr, dispatch);
+		}
 
 		// ------------------------------------------------------------------ //
 		// Helpers.
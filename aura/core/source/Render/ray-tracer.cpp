@@ -7,13 +7,23 @@
 // Internal includes.
 #include <Aura/Core/settings.hpp>
 #include <Aura/Core/Environment/structures.hpp>
+#include <Aura/Core/Environment/hierarchy.hpp>
+#include <Aura/Core/Environment/hierarchy-cache.hpp>
+#include <Aura/Core/Environment/streams.hpp>
 #include <Aura/Core/Render/structures.hpp>
 #include <Aura/Core/Utilities/thread_pool.hpp>
 #include "framework.hpp"
 #include "swapchain.hpp"
 // Standard includes.
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 // External includes.
@@ -42,14 +52,16 @@ namespace Aura::Core
 		vk::SurfaceKHR const & surface, vk::Extent2D const & chain_base_extent,
 		std::uint32_t const compute_family, std::uint32_t const transfer_family,
 		std::uint32_t const present_family, ThreadPool & thread_pool,
-		std::uint32_t const width, std::uint32_t const height,
+		std::uint32_t const width, std::uint32_t const height, std::uint32_t const batch,
+		std::uint32_t const tile_width, std::uint32_t const tile_height,
 		std::shared_mutex & scene_guard, Scene * const & scene) :
 		VulkanSwapchain(dispatch, instance, physical_device, device,
 			surface, chain_base_extent, std::vector<std::uint32_t>{compute_family, present_family}),
-		width(width), height(height),
+		width(width), height(height), batch(batch), tile_width(tile_width), tile_height(tile_height),
 		scene_guard(scene_guard), scene(scene),
 		compute_family(compute_family), transfer_family(transfer_family)
 	{
+		validateBatch();
 		setUpResources(thread_pool);
 		setUpPipelines(thread_pool);
 	}
@@ -76,8 +88,8 @@ namespace Aura::Core
 		command.bindPipeline(bind_point, pre_process.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, pre_process.layout, 0U,
 			n_sets, sets.data(), 0U, nullptr, dispatch);
-		std::uint32_t x = (width + pre_gsize[0U] - 1) / pre_gsize[0U];
-		std::uint32_t y = (height + pre_gsize[1U] - 1) / pre_gsize[1U];
+		std::uint32_t x = (tile_width + pre_gsize[0U] - 1) / pre_gsize[0U];
+		std::uint32_t y = (tile_height + pre_gsize[1U] - 1) / pre_gsize[1U];
 		std::uint32_t z = (1U + pre_gsize[2U] - 1) / pre_gsize[2U];
 		command.dispatch(x, y, z, dispatch);
 	}
@@ -89,7 +101,7 @@ namespace Aura::Core
 		constexpr std::uint32_t n_sets { 2U };
 		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
 		std::array<vk::DescriptorSet, n_sets> const sets {
-			render_settings.set, scene_info.set };
+			render_settings.set, scene_info[scene_copy].set };
 
 		command.bindPipeline(bind_point, vertex.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, vertex.layout, 0U,
@@ -100,73 +112,740 @@ namespace Aura::Core
 		command.dispatch(x, y, z, dispatch);
 	}
 	/// <summary>
-	/// Records a ray gen operation.
+	/// Records a device hierarchy build over the transformed primitives.
+	/// Morton codes, sort, linear build and refit run as separate passes.
+	/// With hierarchy validation, the result is copied back to host memory.
 	/// </summary>
-	void RayTracer::recordRayGen(RandomSeed & push, vk::CommandBuffer const & command) const
+	void RayTracer::recordHierarchyBuild(vk::CommandBuffer const & command) const
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 4U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, scene_info[scene_copy].set, build_state.set };
+		std::array<Pipeline const *, n_passes> const passes { &morton, &sort, &build, &refit };
+		// Codes and sort run in a single work group, build and refit per primitive.
+		std::array<std::uint32_t, n_passes> const groups { 1U, 1U,
+			(n_primitives + build_gsize[0U] - 1) / build_gsize[0U],
+			(n_primitives + refit_gsize[0U] - 1) / refit_gsize[0U] };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		if(n_primitives == 0U) { return; }
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+				{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+			command.bindPipeline(bind_point, passes[i]->pipeline, dispatch);
+			command.bindDescriptorSets(bind_point, passes[i]->layout, 0U,
+				n_sets, sets.data(), 0U, nullptr, dispatch);
+			command.dispatch(groups[i], 1U, 1U, dispatch);
+		}
+		if constexpr(DebugSettings::validate_hierarchy)
+		{
+			// Scene info is device local, so the built nodes and references
+			// are copied back for the host to validate them.
+			vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead };
+			vk::MemoryBarrier const after { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead };
+			std::array<vk::BufferCopy, 2U> const regions {
+				vk::BufferCopy { 0U, scene_readback.buffers[0U].offset, scene_readback.buffers[0U].range },
+				vk::BufferCopy { 0U, scene_readback.buffers[1U].offset, scene_readback.buffers[1U].range } };
+
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+				{}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+			command.copyBuffer(scene_info[scene_copy].buffers[4U].buffer, scene_readback.buffers[0U].buffer,
+				1U, &regions[0U], dispatch);
+			command.copyBuffer(scene_info[scene_copy].buffers[5U].buffer, scene_readback.buffers[1U].buffer,
+				1U, &regions[1U], dispatch);
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+				{}, 1U, &after, 0U, nullptr, 0U, nullptr, dispatch);
+		}
+	}
+	/// <summary>
+	/// Records an adaptive sampling mask operation, marking the pixels of
+	/// the tile which still take samples. The mask is made visible to the
+	/// ray-generation or megakernel operation that follows.
+	/// </summary>
+	void RayTracer::recordAdaptiveMask(vk::CommandBuffer const & command) const
+	{
+		constexpr std::uint32_t n_sets { 2U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets { render_settings.set, rays_state.set };
+		// Pixels and moments cleared by the pre-process or added by earlier
+		// samples are read, and the mask the last sample read is rewritten.
+		vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+		// Ray generation reads the mask.
+		vk::MemoryBarrier const after { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+		command.bindPipeline(bind_point, adaptive_mask.pipeline, dispatch);
+		command.bindDescriptorSets(bind_point, adaptive_mask.layout, 0U,
+			n_sets, sets.data(), 0U, nullptr, dispatch);
+		std::uint32_t x = (tile_width + adaptive_gsize[0U] - 1) / adaptive_gsize[0U];
+		std::uint32_t y = (tile_height + adaptive_gsize[1U] - 1) / adaptive_gsize[1U];
+		std::uint32_t z = (1U + adaptive_gsize[2U] - 1) / adaptive_gsize[2U];
+		command.dispatch(x, y, z, dispatch);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &after, 0U, nullptr, 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Records a ray gen operation for every sample of the batch, over the
+	/// tile at the given image origin. Generated rays are appended to the
+	/// first bounce queue.
+	/// </summary>
+	void RayTracer::recordRayGen(SampleSeed const & push, vk::CommandBuffer const & command,
+		glm::uvec2 const tile) const
 	{
 		constexpr std::uint32_t n_sets { 3U };
 		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
 		std::array<vk::DescriptorSet, n_sets> const sets {
 			render_settings.set, ray_launcher.set, rays_state.set };
 
+		recordQueueReset(0U, command);
 		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
 			{}, 0, nullptr, 0, nullptr, 0, nullptr, dispatch);
 		command.bindPipeline(bind_point, gen.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, gen.layout, 0U,
 			n_sets, sets.data(), 0U, nullptr, dispatch);
 		command.pushConstants(gen.layout, vk::ShaderStageFlagBits::eCompute,
-			0U, sizeof(RandomSeed), reinterpret_cast<void *>(&push), dispatch);
-		std::uint32_t x = (width + gen_gsize[0U] - 1) / gen_gsize[0U];
-		std::uint32_t y = (height + gen_gsize[1U] - 1) / gen_gsize[1U];
-		std::uint32_t z = (1U + gen_gsize[2U] - 1) / gen_gsize[2U];
+			0U, sizeof(SampleSeed), reinterpret_cast<void const *>(&push), dispatch);
+		command.pushConstants(gen.layout, vk::ShaderStageFlagBits::eCompute,
+			tile_push_offset, sizeof(glm::uvec2), reinterpret_cast<void const *>(&tile), dispatch);
+		std::uint32_t x = (tile_width + gen_gsize[0U] - 1) / gen_gsize[0U];
+		std::uint32_t y = (tile_height + gen_gsize[1U] - 1) / gen_gsize[1U];
+		std::uint32_t z = (batch + gen_gsize[2U] - 1) / gen_gsize[2U];
 		command.dispatch(x, y, z, dispatch);
 	}
 	/// <summary>
-	/// Records a intersect operation.
+	/// Records a sort of the rays queued for the given bounce by their
+	/// direction octant and quantized origin. Must be recorded before the
+	/// intersect operation of the bounce, which then reads the sorted rays.
 	/// </summary>
-	void RayTracer::recordIntersect(vk::CommandBuffer const & command) const
+	void RayTracer::recordRaySort(vk::CommandBuffer const & command, std::uint32_t const bounce) const
 	{
 		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 4U };
 		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
 		std::array<vk::DescriptorSet, n_sets> const sets {
-			render_settings.set, rays_state.set, scene_info.set };
-
-		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
-			{}, 0, nullptr, 0, nullptr, 0, nullptr, dispatch);
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Origins are bounded first, then rays are counted in their buckets,
+		// the counts turned into the first slot of each bucket and the rays
+		// scattered. The prefix sum runs in a single work group.
+		std::array<Pipeline const *, n_passes> const passes { &ray_bounds, &ray_count, &ray_prefix, &ray_scatter };
+		std::array<bool, n_passes> const queued { true, true, false, true };
+		std::uint32_t queue { bounce % n_ray_queues };
+		// Bounds start empty, with the minimum bits all set, and the counts
+		// after them at zero.
+		std::uint32_t const empty_min { 0xFFFFFFFFU };
+		vk::DeviceSize const bounds_size { 4U * sizeof(std::uint32_t) };
+		vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eTransferWrite };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eTransfer, {}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+		// Both fills are disjoint, transfer writes to the same bytes would need
+		// a barrier between them.
+		command.fillBuffer(rays_state.buffers[8U].buffer, 0U, bounds_size, empty_min, dispatch);
+		command.fillBuffer(rays_state.buffers[8U].buffer, bounds_size, VK_WHOLE_SIZE, 0U, dispatch);
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+				{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+			command.bindPipeline(bind_point, passes[i]->pipeline, dispatch);
+			command.bindDescriptorSets(bind_point, passes[i]->layout, 0U,
+				n_sets, sets.data(), 0U, nullptr, dispatch);
+			command.pushConstants(passes[i]->layout, vk::ShaderStageFlagBits::eCompute,
+				0U, sizeof(std::uint32_t), reinterpret_cast<void *>(&queue), dispatch);
+			if(queued[i])
+			{
+				command.dispatchIndirect(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), dispatch);
+			}
+			else
+			{
+				command.dispatch(1U, 1U, 1U, dispatch);
+			}
+		}
+	}
+	/// <summary>
+	/// Records a intersect operation over the rays queued for the given
+	/// bounce, dispatched indirectly from the queue size. Rays are read in
+	/// their sorted order if requested. The index tells the intersection apart
+	/// within the frame, for its timestamps.
+	/// </summary>
+	void RayTracer::recordIntersect(vk::CommandBuffer const & command, std::uint32_t const intersect_idx,
+		std::uint32_t const bounce, bool const sorted) const
+	{
+		// Samples are recorded in parallel with the reset, so only the pool size
+		// is checked here.
+		bool const timed { DebugSettings::intersect_time && 2U * intersect_idx + 1U < max_intersect_queries };
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Queue and whenever to read its rays in their sorted order.
+		std::array<std::uint32_t, 2U> source { bounce % n_ray_queues, sorted ? 1U : 0U };
+		std::uint32_t const queue { source[0U] };
+		// Queue sizes are written by the previous stage and read as dispatch
+		// arguments.
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
 		command.bindPipeline(bind_point, intersect.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, intersect.layout, 0U,
 			n_sets, sets.data(), 0U, nullptr, dispatch);
-		std::uint32_t x = (width + intersect_gsize[0U] - 1) / intersect_gsize[0U];
-		std::uint32_t y = (height + intersect_gsize[1U] - 1) / intersect_gsize[1U];
-		std::uint32_t z = (1U + intersect_gsize[2U] - 1) / intersect_gsize[2U];
-		command.dispatch(x, y, z, dispatch);
+		command.pushConstants(intersect.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(source), reinterpret_cast<void *>(source.data()), dispatch);
+		if(timed)
+		{
+			// The queue size is final before the intersection, it is copied
+			// back to count the traced rays.
+			vk::BufferCopy const region { queue * sizeof(RayQueue) + offsetof(RayQueue, count),
+				intersect_idx * sizeof(std::uint32_t), sizeof(std::uint32_t) };
+			vk::MemoryBarrier const count_barrier { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead };
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+				{}, 1U, &count_barrier, 0U, nullptr, 0U, nullptr, dispatch);
+			command.copyBuffer(rays_state.buffers[5U].buffer, intersect_counts.buffers[0U].buffer,
+				1U, &region, dispatch);
+			command.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
+				intersect_queries, 2U * intersect_idx, dispatch);
+		}
+		command.dispatchIndirect(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), dispatch);
+		if(timed)
+		{
+			command.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
+				intersect_queries, 2U * intersect_idx + 1U, dispatch);
+		}
 	}
 	/// <summary>
-	/// Records a scatter operation.
+	/// Records an occlusion operation. Rays stop at their first hit and only
+	/// write their occlusion bit, hits are left untouched.
 	/// </summary>
-	void RayTracer::recordColourAndScatter(RandomPointInCircleAndSeed & push, vk::CommandBuffer const & command) const
+	void RayTracer::recordOcclusion(vk::CommandBuffer const & command) const
 	{
 		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::uint32_t shadows { 0U };
 		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
 		std::array<vk::DescriptorSet, n_sets> const sets {
-			render_settings.set, rays_state.set, scene_info.set };
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
 
 		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
 			{}, 0, nullptr, 0, nullptr, 0, nullptr, dispatch);
+		command.bindPipeline(bind_point, occlusion.pipeline, dispatch);
+		command.bindDescriptorSets(bind_point, occlusion.layout, 0U,
+			n_sets, sets.data(), 0U, nullptr, dispatch);
+		command.pushConstants(occlusion.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(std::uint32_t), reinterpret_cast<void const *>(&shadows), dispatch);
+		// Every ray of the tile, in rows of groups like the queued dispatches.
+		std::uint32_t const n_groups { (tile_width * tile_height * batch + occlusion_gsize[0U] - 1U) /
+			occlusion_gsize[0U] };
+		std::uint32_t x = std::min(n_groups, queue_row);
+		std::uint32_t y = (n_groups + queue_row - 1U) / queue_row;
+		command.dispatch(x, y, 1U, dispatch);
+	}
+	/// <summary>
+	/// Records a shadow operation, with the occlusion pipeline. Shadow rays
+	/// left by the scatter of the given bounce stop at their first hit before
+	/// their light point, and the unblocked ones add their light to the path
+	/// sample of their ray. Paths that ended on that scatter add their sample
+	/// then. Only the rays queued for the bounce may have left a shadow ray,
+	/// so the dispatch follows their queue.
+	/// </summary>
+	void RayTracer::recordShadows(vk::CommandBuffer const & command, std::uint32_t const bounce) const
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Shadow rays instead of rays, and the queue the scatter read.
+		std::array<std::uint32_t, 2U> const mode { 1U, bounce % n_ray_queues };
+		// Shadow rays and path samples are written by the previous stage.
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+		command.bindPipeline(bind_point, occlusion.pipeline, dispatch);
+		command.bindDescriptorSets(bind_point, occlusion.layout, 0U,
+			n_sets, sets.data(), 0U, nullptr, dispatch);
+		command.pushConstants(occlusion.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(mode), reinterpret_cast<void const *>(mode.data()), dispatch);
+		command.dispatchIndirect(rays_state.buffers[5U].buffer, mode[1U] * sizeof(RayQueue), dispatch);
+	}
+	/// <summary>
+	/// Records the reset of the intersection timestamps of a frame with the
+	/// given number of samples and bounces.
+	/// </summary>
+	void RayTracer::recordIntersectQueriesReset(std::uint32_t const n_samples, std::uint32_t const n_bounces,
+		vk::CommandBuffer const & command) const
+	{
+		n_intersect_queries = std::min(2U * n_samples * n_bounces, max_intersect_queries);
+		n_intersect_bounces = std::max(n_bounces, 1U);
+		if(n_intersect_queries == 0U) { return; }
+		command.resetQueryPool(intersect_queries, 0U, n_intersect_queries, dispatch);
+	}
+	/// <summary>
+	/// Outputs the queued rays per second of the intersection stage on the
+	/// last frame, for primary and secondary rays. The frame must be finished.
+	/// </summary>
+	void RayTracer::outputIntersectTime() const
+	{
+		if(n_intersect_queries == 0U) { return; }
+		std::vector<std::uint64_t> timestamps(n_intersect_queries);
+		vk::Result const result { device.getQueryPoolResults(intersect_queries, 0U, n_intersect_queries,
+			timestamps.size() * sizeof(std::uint64_t), timestamps.data(), sizeof(std::uint64_t),
+			vk::QueryResultFlagBits::e64, dispatch) };
+		if(result != vk::Result::eSuccess) { return; }
+		// Queued rays, copied back along with the timestamps.
+		std::vector<std::uint32_t> counts(n_intersect_queries / 2U);
+		void * mem { nullptr };
+		vk::Result const map_result { device.mapMemory(intersect_counts.memories[0U], 0U,
+			intersect_counts.buffers[0U].range, {}, &mem, dispatch) };
+		if(map_result != vk::Result::eSuccess || !mem) { return; }
+		std::memcpy(counts.data(), mem, counts.size() * sizeof(std::uint32_t));
+		device.unmapMemory(intersect_counts.memories[0U], dispatch);
+		// Intersections are numbered by sample and then bounce, the first
+		// bounce of each sample traces the primary rays.
+		std::array<std::uint64_t, 2U> ticks { 0U, 0U };
+		std::array<double, 2U> rays { 0.0, 0.0 };
+		for(std::size_t i { 0U }; i + 1U < timestamps.size(); i += 2U)
+		{
+			std::size_t const secondary { (i / 2U) % n_intersect_bounces != 0U ? 1U : 0U };
+			ticks[secondary] += timestamps[i + 1U] - timestamps[i];
+			rays[secondary] += static_cast<double>(counts[i / 2U]);
+		}
+		std::array<char const *, 2U> const names { "Primary intersect: ", "Secondary intersect: " };
+		for(std::size_t i { 0U }; i < 2U; ++i)
+		{
+			double const seconds { static_cast<double>(ticks[i]) * timestamp_period * 1.0e-9 };
+			if(seconds > 0.0)
+			{
+				std::cout << names[i] << seconds * 1.0e3 << " ms, " << rays[i] / seconds * 1.0e-6
+					<< " Mrays/s." << std::endl;
+			}
+		}
+	}
+	/// <summary>
+	/// Records a copy of the rays left alive after the given bounce. The index
+	/// tells the bounce apart within the frame.
+	/// </summary>
+	void RayTracer::recordActiveRays(vk::CommandBuffer const & command, std::uint32_t const bounce_idx,
+		std::uint32_t const bounce) const
+	{
+		if(bounce_idx >= max_active_counts) { return; }
+		// Survivors are counted on the queue of the next bounce.
+		vk::BufferCopy const region { ((bounce + 1U) % n_ray_queues) * sizeof(RayQueue) + offsetof(RayQueue, count),
+			bounce_idx * sizeof(std::uint32_t), sizeof(std::uint32_t) };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+			{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+		command.copyBuffer(rays_state.buffers[5U].buffer, active_counts.buffers[0U].buffer, 1U, &region, dispatch);
+	}
+	/// <summary>
+	/// Outputs the rays left alive after each bounce on the last frame,
+	/// averaged over its samples. The frame must be finished.
+	/// </summary>
+	void RayTracer::outputActiveRays(std::uint32_t const n_samples, std::uint32_t const n_bounces) const
+	{
+		std::uint32_t const n_counts { std::min(n_samples * n_bounces, max_active_counts) };
+		if(n_counts == 0U) { return; }
+		std::vector<std::uint32_t> counts(n_counts);
+		void * mem { nullptr };
+		vk::Result const result { device.mapMemory(active_counts.memories[0U], 0U,
+			active_counts.buffers[0U].range, {}, &mem, dispatch) };
+		if(result != vk::Result::eSuccess || !mem) { return; }
+		std::memcpy(counts.data(), mem, n_counts * sizeof(std::uint32_t));
+		device.unmapMemory(active_counts.memories[0U], dispatch);
+		// Counts are numbered by sample and then bounce.
+		std::vector<double> active(n_bounces, 0.0);
+		for(std::size_t i { 0U }; i < counts.size(); ++i)
+		{
+			active[i % n_bounces] += static_cast<double>(counts[i]) / n_samples;
+		}
+		std::cout << "Active rays:";
+		for(double const rays : active)
+		{
+			std::cout << " " << rays;
+		}
+		std::cout << std::endl;
+	}
+	/// <summary>
+	/// Prepares the pixels read back buffer and memory.
+	/// </summary>
+	void RayTracer::setUpPixelReadback()
+	{
+		vk::DeviceSize const pixels_size { rays_state.buffers[2U].range };
+		vk::Buffer buffer {};
+		createBuffer({}, pixels_size, vk::BufferUsageFlagBits::eTransferDst, 1U, &compute_family, buffer);
+		vk::MemoryRequirements mem {};
+		device.getBufferMemoryRequirements(buffer, &mem, dispatch);
+
+		pixel_readback.buffers.resize(1U);
+		pixel_readback.buffers[0U].buffer = buffer;
+		pixel_readback.buffers[0U].range = pixels_size;
+		pixel_readback.buffers[0U].offset = 0U;
+
+		vk::MemoryPropertyFlags const required {
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+		std::uint32_t type_index { 0U };
+		if(!findMemoryType(mem.memoryTypeBits, required, type_index))
+		{
+			throw std::exception("No memory with required properties. [Pixel readback]");
+		}
+
+		pixel_readback.memories.resize(1U);
+		allocateMemory(mem.size, type_index, pixel_readback.memories[0U]);
+		device.bindBufferMemory(pixel_readback.buffers[0U].buffer, pixel_readback.memories[0U],
+			pixel_readback.buffers[0U].offset, dispatch);
+	}
+	/// <summary>
+	/// Records a copy of the accumulated pixels to the read back buffer.
+	/// </summary>
+	void RayTracer::recordPixelReadback(vk::CommandBuffer const & command) const
+	{
+		vk::BufferCopy const region { rays_state.buffers[2U].offset, 0U, rays_state.buffers[2U].range };
+		vk::MemoryBarrier const to_copy { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead };
+		vk::MemoryBarrier const to_host { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+			{}, 1U, &to_copy, 0U, nullptr, 0U, nullptr, dispatch);
+		command.copyBuffer(rays_state.buffers[2U].buffer, pixel_readback.buffers[0U].buffer, 1U, &region, dispatch);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+			{}, 1U, &to_host, 0U, nullptr, 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Mean luminance of the pixels read back, over the pixels with any
+	/// sample. Covers the last traced tile, the whole image unless tiled. The
+	/// copy must be finished.
+	/// </summary>
+	float RayTracer::readMeanLuminance() const
+	{
+		std::size_t const n_pixels { static_cast<std::size_t>(tile_width) * tile_height };
+		std::vector<Pixel> pixels(n_pixels * batch);
+		void * mem { nullptr };
+		vk::Result const result { device.mapMemory(pixel_readback.memories[0U], 0U,
+			pixel_readback.buffers[0U].range, {}, &mem, dispatch) };
+		if(result != vk::Result::eSuccess || !mem) { return 0.0f; }
+		std::memcpy(pixels.data(), mem, pixels.size() * sizeof(Pixel));
+		device.unmapMemory(pixel_readback.memories[0U], dispatch);
+		// Samples of a batch accumulate on separate slices, merged the same
+		// way the post-processing does. Luminance weights match the shaders.
+		double sum { 0.0 };
+		std::size_t n_sampled { 0U };
+		for(std::size_t i { 0U }; i < n_pixels; ++i)
+		{
+			glm::vec4 colour { 0.0f };
+			for(std::size_t b { 0U }; b < batch; ++b)
+			{
+				colour += pixels[i + b * n_pixels].colour;
+			}
+			if(colour.a <= 0.0f) { continue; }
+			glm::vec3 const mean { glm::vec3(colour) / colour.a };
+			sum += 0.2126 * mean.r + 0.7152 * mean.g + 0.0722 * mean.b;
+			++n_sampled;
+		}
+		return n_sampled == 0U ? 0.0f : static_cast<float>(sum / static_cast<double>(n_sampled));
+	}
+	/// <summary>
+	/// Destroys the pixels read back buffer and memory.
+	/// </summary>
+	void RayTracer::tearDownPixelReadback()
+	{
+		destroyBuffer(pixel_readback.buffers[0U].buffer);
+		freeMemory(pixel_readback.memories[0U]);
+	}
+	/// <summary>
+	/// Whenever scene info updates are staged, or the last upload is not
+	/// replayed yet, and wait for an upload.
+	/// </summary>
+	bool RayTracer::uploadPending() const noexcept
+	{
+		return staging_head != 0U || std::any_of(replayed_copies.begin(), replayed_copies.end(),
+			[](std::vector<vk::BufferCopy> const & copies) { return !copies.empty(); });
+	}
+	/// <summary>
+	/// Records the release of the scene info buffers the next upload writes
+	/// to, on the copy the recorded frames do not bind, from the compute
+	/// family to the transfer family. Records nothing if both queues share a
+	/// family.
+	/// </summary>
+	void RayTracer::recordSceneRelease(vk::CommandBuffer const & command) const
+	{
+		if(compute_family == transfer_family) { return; }
+		Resource const & target { scene_info[(scene_copy + 1U) % scene_copies] };
+		// Whole buffers change hands, partial updates keep the rest of them.
+		std::vector<vk::BufferMemoryBarrier> barriers {};
+		for(std::size_t i { 0U }; i < staged_copies.size(); ++i)
+		{
+			if(staged_copies[i].empty() && replayed_copies[i].empty()) { continue; }
+			barriers.emplace_back(vk::AccessFlags {}, vk::AccessFlags {},
+				compute_family, transfer_family, target.buffers[i].buffer, 0U, VK_WHOLE_SIZE);
+		}
+		// The frames that read the copy are finished, their fence made their
+		// writes available, so the release waits on no work in flight.
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eBottomOfPipe,
+			{}, 0U, nullptr, static_cast<std::uint32_t>(barriers.size()), barriers.data(), 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Records the copies of the last upload and of the staged scene info
+	/// updates to the copy the recorded frames do not bind, for the transfer
+	/// queue, with the release of the written buffers back to the compute
+	/// family. Later frames bind the written copy, and later updates are
+	/// staged in the next slot.
+	/// </summary>
+	void RayTracer::recordSceneUpload(vk::CommandBuffer const & command)
+	{
+		bool const handover { compute_family != transfer_family };
+		std::uint32_t const target_copy { (scene_copy + 1U) % scene_copies };
+		Resource const & target { scene_info[target_copy] };
+		std::vector<vk::BufferMemoryBarrier> acquires {}, releases {};
+		bool replayed { false }, staged { false };
+
+		uploaded_buffers.clear();
+		for(std::size_t i { 0U }; i < staged_copies.size(); ++i)
+		{
+			if(staged_copies[i].empty() && replayed_copies[i].empty()) { continue; }
+			uploaded_buffers.push_back(i);
+			replayed = replayed || !replayed_copies[i].empty();
+			staged = staged || !staged_copies[i].empty();
+			acquires.emplace_back(vk::AccessFlags {}, vk::AccessFlagBits::eTransferWrite,
+				compute_family, transfer_family, target.buffers[i].buffer, 0U, VK_WHOLE_SIZE);
+			releases.emplace_back(vk::AccessFlagBits::eTransferWrite, vk::AccessFlags {},
+				transfer_family, compute_family, target.buffers[i].buffer, 0U, VK_WHOLE_SIZE);
+		}
+		if(handover)
+		{
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+				{}, 0U, nullptr, static_cast<std::uint32_t>(acquires.size()), acquires.data(), 0U, nullptr, dispatch);
+		}
+		// The copy missed the last upload, written to the other one, so it
+		// is replayed first and the staged updates land over it.
+		for(std::size_t const i : uploaded_buffers)
+		{
+			if(replayed_copies[i].empty()) { continue; }
+			command.copyBuffer(staging.buffers[0U].buffer, target.buffers[i].buffer,
+				static_cast<std::uint32_t>(replayed_copies[i].size()), replayed_copies[i].data(), dispatch);
+		}
+		if(replayed && staged)
+		{
+			vk::MemoryBarrier const barrier { vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite };
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+				{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+		}
+		for(std::size_t const i : uploaded_buffers)
+		{
+			if(!staged_copies[i].empty())
+			{
+				command.copyBuffer(staging.buffers[0U].buffer, target.buffers[i].buffer,
+					static_cast<std::uint32_t>(staged_copies[i].size()), staged_copies[i].data(), dispatch);
+			}
+			// The other copy misses the staged updates in turn.
+			replayed_copies[i] = std::move(staged_copies[i]);
+			staged_copies[i].clear();
+		}
+		if(handover)
+		{
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+				{}, 0U, nullptr, static_cast<std::uint32_t>(releases.size()), releases.data(), 0U, nullptr, dispatch);
+		}
+		scene_copy = target_copy;
+		if(staged)
+		{
+			staging_slot = (staging_slot + 1U) % staging_slots;
+			staging_head = 0U;
+		}
+	}
+	/// <summary>
+	/// Records the compute family acquire of the scene info buffers written
+	/// by the last upload. Within a family, the upload semaphore alone makes
+	/// the copies visible.
+	/// </summary>
+	void RayTracer::recordSceneAcquire(vk::CommandBuffer const & command) const
+	{
+		if(compute_family == transfer_family) { return; }
+		std::vector<vk::BufferMemoryBarrier> barriers {};
+		for(std::size_t const i : uploaded_buffers)
+		{
+			barriers.emplace_back(vk::AccessFlags {}, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+				transfer_family, compute_family, scene_info[scene_copy].buffers[i].buffer, 0U, VK_WHOLE_SIZE);
+		}
+		// Chained to the upload semaphore wait, on the same stage.
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{}, 0U, nullptr, static_cast<std::uint32_t>(barriers.size()), barriers.data(), 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Records a counting sort of the rays queued for the given bounce by the
+	/// type of their hit material. The following scatter operation then
+	/// shades the sorted rays, so work groups run the same material path.
+	/// Must be recorded between the intersect and scatter operations of the
+	/// bounce.
+	/// </summary>
+	void RayTracer::recordMaterialSort(vk::CommandBuffer const & command, std::uint32_t const bounce) const
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 2U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Buckets are counted first, then rays are scattered past the counts of
+		// the buckets before their own.
+		std::array<Pipeline const *, n_passes> const passes { &material_count, &material_scatter };
+		std::uint32_t queue { bounce % n_ray_queues };
+		vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eTransferWrite };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eTransfer, {}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+		command.fillBuffer(rays_state.buffers[7U].buffer, 0U, VK_WHOLE_SIZE, 0U, dispatch);
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+				{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+			command.bindPipeline(bind_point, passes[i]->pipeline, dispatch);
+			command.bindDescriptorSets(bind_point, passes[i]->layout, 0U,
+				n_sets, sets.data(), 0U, nullptr, dispatch);
+			command.pushConstants(passes[i]->layout, vk::ShaderStageFlagBits::eCompute,
+				0U, sizeof(std::uint32_t), reinterpret_cast<void *>(&queue), dispatch);
+			command.dispatchIndirect(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), dispatch);
+		}
+	}
+	/// <summary>
+	/// Records a scatter operation over the rays queued for the given bounce.
+	/// Rays are read in their sorted order if requested. Rays left alive are
+	/// queued for the next bounce.
+	/// </summary>
+	void RayTracer::recordColourAndScatter(SampleSeed const & push, vk::CommandBuffer const & command,
+		std::uint32_t const bounce, bool const sorted) const
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Queue, whenever to read its rays in their sorted order and bounce.
+		std::array<std::uint32_t, 3U> source { bounce % n_ray_queues, sorted ? 1U : 0U, bounce };
+		std::uint32_t const queue { source[0U] };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		recordQueueReset((bounce + 1U) % n_ray_queues, command);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
 		command.bindPipeline(bind_point, colour_and_scatter.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, colour_and_scatter.layout, 0U,
 			n_sets, sets.data(), 0U, nullptr, dispatch);
 		command.pushConstants(colour_and_scatter.layout, vk::ShaderStageFlagBits::eCompute,
-			0U, sizeof(RandomPointInCircleAndSeed), reinterpret_cast<void *>(&push), dispatch);
-		std::uint32_t x = (width + colour_and_scatter_gsize[0U] - 1) / colour_and_scatter_gsize[0U];
-		std::uint32_t y = (height + colour_and_scatter_gsize[1U] - 1) / colour_and_scatter_gsize[1U];
-		std::uint32_t z = (1U + colour_and_scatter_gsize[2U] - 1) / colour_and_scatter_gsize[2U];
-		command.dispatch(x, y, z, dispatch);
+			0U, sizeof(SampleSeed), reinterpret_cast<void const *>(&push), dispatch);
+		command.pushConstants(colour_and_scatter.layout, vk::ShaderStageFlagBits::eCompute,
+			sizeof(SampleSeed), sizeof(source), reinterpret_cast<void *>(source.data()), dispatch);
+		command.dispatchIndirect(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), dispatch);
+	}
+	/// <summary>
+	/// Records a fused intersect and scatter operation over the rays queued
+	/// for the given bounce, with hits kept in registers. Stands for both
+	/// operations of the bounce, rays are read in their sorted order if
+	/// requested and rays left alive are queued for the next.
+	/// </summary>
+	void RayTracer::recordBounce(SampleSeed const & push, vk::CommandBuffer const & command,
+		std::uint32_t const bounce, bool const sorted) const
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, rays_state.set, scene_info[scene_copy].set };
+		// Queue, whenever to read its rays in their sorted order and bounce.
+		std::array<std::uint32_t, 3U> source { bounce % n_ray_queues, sorted ? 1U : 0U, bounce };
+		std::uint32_t const queue { source[0U] };
+		vk::MemoryBarrier const barrier { vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		recordQueueReset((bounce + 1U) % n_ray_queues, command);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &barrier, 0U, nullptr, 0U, nullptr, dispatch);
+		command.bindPipeline(bind_point, fused_bounce.pipeline, dispatch);
+		command.bindDescriptorSets(bind_point, fused_bounce.layout, 0U,
+			n_sets, sets.data(), 0U, nullptr, dispatch);
+		command.pushConstants(fused_bounce.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(SampleSeed), reinterpret_cast<void const *>(&push), dispatch);
+		command.pushConstants(fused_bounce.layout, vk::ShaderStageFlagBits::eCompute,
+			sizeof(SampleSeed), sizeof(source), reinterpret_cast<void *>(source.data()), dispatch);
+		command.dispatchIndirect(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), dispatch);
+	}
+	/// <summary>
+	/// Records the reset of the given ray queue to an empty queue.
+	/// </summary>
+	void RayTracer::recordQueueReset(std::uint32_t const queue, vk::CommandBuffer const & command) const
+	{
+		RayQueue const empty {};
+		// Previous readers of the queue must be done before it is cleared.
+		vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eTransferWrite };
+		vk::MemoryBarrier const after { vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eDrawIndirect,
+			vk::PipelineStageFlagBits::eTransfer, {}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+		command.updateBuffer(rays_state.buffers[5U].buffer, queue * sizeof(RayQueue), sizeof(RayQueue),
+			reinterpret_cast<void const *>(&empty), dispatch);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+			{}, 1U, &after, 0U, nullptr, 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Records a megakernel operation, which traces every bounce of every
+	/// pixel on its own. Stands for the ray-generation, intersect and scatter
+	/// operations of a sample, over the tile at the given image origin.
+	/// </summary>
+	void RayTracer::recordMegakernel(SampleSeed const & push, vk::CommandBuffer const & command,
+		glm::uvec2 const tile) const
+	{
+		constexpr std::uint32_t n_sets { 4U };
+		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
+		std::array<vk::DescriptorSet, n_sets> const sets {
+			render_settings.set, ray_launcher.set, rays_state.set, scene_info[scene_copy].set };
+		std::uint32_t const first_pixel { 0U };
+		// Previous samples must be done with the counter before it is cleared.
+		vk::MemoryBarrier const before { vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eTransferWrite };
+		vk::MemoryBarrier const after { vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+			{}, 1U, &before, 0U, nullptr, 0U, nullptr, dispatch);
+		command.updateBuffer(rays_state.buffers[9U].buffer, 0U, sizeof(std::uint32_t),
+			reinterpret_cast<void const *>(&first_pixel), dispatch);
+		command.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+			vk::PipelineStageFlagBits::eComputeShader, {}, 1U, &after, 0U, nullptr, 0U, nullptr, dispatch);
+		command.bindPipeline(bind_point, megakernel.pipeline, dispatch);
+		command.bindDescriptorSets(bind_point, megakernel.layout, 0U,
+			n_sets, sets.data(), 0U, nullptr, dispatch);
+		command.pushConstants(megakernel.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(SampleSeed), reinterpret_cast<void const *>(&push), dispatch);
+		command.pushConstants(megakernel.layout, vk::ShaderStageFlagBits::eCompute,
+			tile_push_offset, sizeof(glm::uvec2), reinterpret_cast<void const *>(&tile), dispatch);
+		// Persistent groups, no more than the tile would need.
+		std::uint32_t const pixel_groups {
+			(tile_width * tile_height * batch + megakernel_gsize[0U] - 1) / megakernel_gsize[0U] };
+		command.dispatch(std::min(pixel_groups, megakernel_groups), 1U, 1U, dispatch);
 	}
 	/// <summary>
-	/// Records a post-processing operation.
+	/// Records a post-processing operation, writing the tile at the given
+	/// image origin to the chain image.
 	/// </summary>
-	void RayTracer::recordPostProcess(vk::CommandBuffer const & command) const
+	void RayTracer::recordPostProcess(vk::CommandBuffer const & command, glm::uvec2 const tile) const
 	{
 		constexpr std::uint32_t n_sets { 3U };
 		vk::PipelineBindPoint const bind_point { vk::PipelineBindPoint::eCompute };
@@ -178,8 +857,10 @@ namespace Aura::Core
 		command.bindPipeline(bind_point, post_process.pipeline, dispatch);
 		command.bindDescriptorSets(bind_point, post_process.layout, 0U,
 			n_sets, sets.data(), 0U, nullptr, dispatch);
-		std::uint32_t x = (width + post_gsize[0U] - 1) / post_gsize[0U];
-		std::uint32_t y = (height + post_gsize[1U] - 1) / post_gsize[1U];
+		command.pushConstants(post_process.layout, vk::ShaderStageFlagBits::eCompute,
+			0U, sizeof(glm::uvec2), reinterpret_cast<void const *>(&tile), dispatch);
+		std::uint32_t x = (tile_width + post_gsize[0U] - 1) / post_gsize[0U];
+		std::uint32_t y = (tile_height + post_gsize[1U] - 1) / post_gsize[1U];
 		std::uint32_t z = (1U + post_gsize[2U] - 1) / post_gsize[2U];
 		command.dispatch(x, y, z, dispatch);
 	}
@@ -188,28 +869,61 @@ namespace Aura::Core
 	// Resource updates.
 	// ------------------------------------------------------------------ //
 	/// <summary>
-	/// Updates the ray launcher using the camera in the scene.
+	/// Updates the render settings, if they changed since the last upload.
+	/// Light counts come from the last scene update, so it must come first.
+	/// Returns whenever they were uploaded.
 	/// </summary>
-	void RayTracer::updateRenderSettings(float const t_min, float const t_max,
-		std::uint32_t const n_samples, std::uint32_t const n_bounces)
+	bool RayTracer::updateRenderSettings(float const t_min, float const t_max,
+		std::uint32_t const n_samples, std::uint32_t const n_bounces,
+		TraversalModes const traversal, std::uint32_t const roulette_depth,
+		float const adaptive_threshold, std::uint32_t const adaptive_min, bool const next_event)
 	{
+		RenderSettings settings {};
 		{
 			std::shared_lock<std::shared_mutex> lock(scene_guard);
 			std::unique_lock<std::mutex> primitives_lock(scene->primitives.guard);
 			n_primitives = static_cast<std::uint32_t>(scene->primitives.data.size());
+			// Stream sizes, counted the same way the streams are built.
+			for(Primitive const & primitive : scene->primitives.data)
+			{
+				switch(primitive.type)
+				{
+					case Primitive::Types::Sphere: ++settings.n_spheres; break;
+					case Primitive::Types::Cuboid: ++settings.n_cuboids; break;
+					case Primitive::Types::Triangle: ++settings.n_triangles; break;
+					default: break;
+				}
+			}
 		}
 
-		RenderSettings settings {};
-		settings.width = width;
-		settings.height = height;
+		settings.width = tile_width;
+		settings.height = tile_height;
+		settings.image_width = width;
+		settings.image_height = height;
 		settings.t_min = t_min;
 		settings.t_max = t_max;
 		settings.n_samples = n_samples;
 		settings.n_bounces = n_bounces;
 		settings.n_primitives = n_primitives;
-
+		settings.traversal = static_cast<std::uint32_t>(traversal);
+		settings.batch = batch;
+		settings.roulette_depth = roulette_depth;
+		settings.adaptive_threshold = adaptive_threshold;
+		settings.adaptive_min = adaptive_min;
+		settings.next_event = next_event ? 1U : 0U;
+		settings.n_lights = static_cast<std::uint32_t>(lights.records.size());
+		settings.light_area = lights.area;
+
+		// Settings are all 4 byte fields, there is no padding to compare.
+		if(settings_uploaded && std::memcmp(&settings, &uploaded_settings, sizeof(RenderSettings)) == 0)
+		{
+			return false;
+		}
 		updateMem(render_settings.buffers[0U], render_settings.memories[0U],
 			render_settings.buffers[0U].range, &settings);
+		uploaded_settings = settings;
+		settings_uploaded = true;
+		return true;
 	}
 	/// <summary>
 	/// Updates the ray launcher using the camera in the scene.
@@ -221,12 +935,13 @@ namespace Aura::Core
 		{
 			std::shared_lock<std::shared_mutex> lock(scene_guard);
 			std::unique_lock<std::mutex> camera_lock(scene->camera.guard);
-			if(!scene->camera.updated)
+			if(!scene->camera.updated && launcher_uploaded)
 			{
 				return false;
 			}
 			camera = scene->camera.data;
 			scene->camera.updated = false;
+			launcher_uploaded = true;
 		}
 		{
 			// Pre-known values.
@@ -260,85 +975,334 @@ namespace Aura::Core
 		return true;
 	}
 	/// <summary>
-	/// Updates scene vertices.
+	/// Traversal drawing the whole scene with the requested one. Only the two
+	/// level traversal draws instances, so scenes with any use it.
+	/// </summary>
+	TraversalModes RayTracer::sceneTraversal(TraversalModes const traversal) const
+	{
+		std::shared_lock<std::shared_mutex> scene_lock(scene_guard);
+		std::unique_lock<std::mutex> entities_lock(scene->entities.guard);
+		for(Entity const & entity : scene->entities.data)
+		{
+			if(entity.source_idx != Entity::no_source) { return TraversalModes::TwoLevel; }
+		}
+		return traversal;
+	}
+	/// <summary>
+	/// Updates scene vertices, transforms and primitives. Geometry changes
+	/// also rebuild and update the hierarchy used by the given traversal. In
+	/// two level traversal, transform only changes rebuild just the top level.
+	/// Lights are rebuilt with any scene or materials change.
 	/// </summary>
-	bool RayTracer::updateScene()
+	bool RayTracer::updateScene(TraversalModes const traversal, HierarchyBuilders const builder,
+		float const refit_threshold, float const spatial_budget, std::string const & cache_directory)
 	{
 		bool update = false;
+		if(cache.directory != cache_directory) { cache.directory = cache_directory; }
 		std::shared_lock<std::shared_mutex> scene_lock(scene_guard);
+		if constexpr(DebugSettings::validate_hierarchy)
 		{
-			std::unique_lock<std::mutex> vertices_lock(scene->vertices.guard);
-			if(scene->vertices.updated)
+			// Render waits for the previous frame, with the device build,
+			// before staging when validating.
+			if(validation_pending)
 			{
-				if constexpr(DebugSettings::split_memory)
-				{
-					updateMem(scene_info.buffers[0U], scene_info.memories[0U],
-						scene->vertices.data.size() * sizeof(Vertex), scene->vertices.data.data());
-				}
-				else
-				{
-					updateMem(scene_info.buffers[0U], scene_info.memories[0U],
-						scene->vertices.data.size() * sizeof(Vertex), scene->vertices.data.data());
-				}
-				scene->vertices.updated = false;
-				update = true;
+				validateHierarchy();
+				validation_pending = false;
 			}
 		}
 		{
+			std::unique_lock<std::mutex> entities_lock(scene->entities.guard);
+			std::unique_lock<std::mutex> vertices_lock(scene->vertices.guard);
 			std::unique_lock<std::mutex> transforms_lock(scene->transforms.guard);
-			if(scene->transforms.updated)
+			std::unique_lock<std::mutex> primitives_lock(scene->primitives.guard);
+			// Switching traversal needs the geometry in a different space, and
+			// switching builder a hierarchy of the new kind.
+			bool const geometry { !scene_uploaded || traversal != scene_traversal || builder != scene_builder ||
+				scene->vertices.updated || scene->primitives.updated || scene->entities.updated };
+			if(traversal == TraversalModes::TwoLevel && (geometry || scene->transforms.updated))
 			{
-				if constexpr(DebugSettings::split_memory)
+				// Geometry stays in object space, there is no vertex stage.
+				if(geometry)
 				{
-					updateMem(scene_info.buffers[1U], scene_info.memories[1U],
-						scene->transforms.data.size() * sizeof(Transform), scene->transforms.data.data());
+					two_level.buildBottom(scene->entities.data, scene->primitives.data, scene->vertices.data, cache);
+					streams.build(scene->primitives.data, scene->vertices.data);
+					updateSceneMem(0U, scene->vertices.data.size() * sizeof(Vertex), scene->vertices.data.data());
+					updateSceneMem(3U, scene->primitives.data.size() * sizeof(Primitive), scene->primitives.data.data());
+					updateStreamsMem();
 				}
-				else
-				{
-					updateMem(scene_info.buffers[1U], scene_info.memories[0U],
-						scene->transforms.data.size() * sizeof(Transform), scene->transforms.data.data());
-				}
-				scene->transforms.updated = false;
+				two_level.buildTop(scene->entities.data, scene->transforms.data);
+				std::size_t const n_nodes { geometry ? two_level.nodes.size() : TwoLevelHierarchy::top_nodes };
+				std::size_t const n_references { geometry ?
+					two_level.references.size() : TwoLevelHierarchy::top_references };
+				updateSceneMem(1U, scene->transforms.data.size() * sizeof(Transform), scene->transforms.data.data());
+				updateSceneMem(4U, n_nodes * sizeof(Node), two_level.nodes.data());
+				// Bottom level references point into the primitive streams.
+				std::vector<std::uint32_t> references { geometry ?
+					streams.encode(two_level.references, TwoLevelHierarchy::top_references) : two_level.references };
+				updateSceneMem(5U, n_references * sizeof(std::uint32_t), references.data());
+				updateSceneMem(6U, two_level.instances.size() * sizeof(Instance), two_level.instances.data());
 				update = true;
 			}
-		}
-		{
-			std::unique_lock<std::mutex> materials_lock(scene->materials.guard);
-			if(scene->materials.updated)
+			else if(traversal != TraversalModes::TwoLevel && (geometry || scene->transforms.updated))
 			{
-				if constexpr(DebugSettings::split_memory)
+				// Vertices and primitives are transformed in place by the vertex
+				// stage, so any geometry change uploads all of them again.
+				std::size_t const n_scene_primitives { scene->primitives.data.size() };
+				// The device builder runs after the vertex stage, only an empty
+				// scene still needs its empty root from the host. Its boxes are
+				// only computed to validate the device build against them.
+				bool const host_build { traversal != TraversalModes::Hierarchy ||
+					builder != HierarchyBuilders::Device || n_scene_primitives == 0U };
+				std::vector<Bounds> bounds {};
+				if(host_build || DebugSettings::validate_hierarchy)
+				{
+					bounds.resize(n_scene_primitives);
+					for(std::size_t i { 0U }; i < n_scene_primitives; ++i)
+					{
+						bounds[i] = Hierarchy::primitiveBounds(scene->primitives.data[i],
+							scene->vertices.data, scene->transforms.data);
+					}
+				}
+				updateSceneMem(0U, scene->vertices.data.size() * sizeof(Vertex), scene->vertices.data.data());
+				updateSceneMem(1U, scene->transforms.data.size() * sizeof(Transform), scene->transforms.data.data());
+				updateSceneMem(3U, n_scene_primitives * sizeof(Primitive), scene->primitives.data.data());
+				if(geometry)
 				{
-					updateMem(scene_info.buffers[2U], scene_info.memories[2U],
-						scene->materials.data.size() * sizeof(Material), scene->materials.data.data());
+					// Slots only change with the geometry, the vertex stage
+					// writes the world space streams on every transform.
+					streams.build(scene->primitives.data, scene->vertices.data);
+					updateStreamsMem();
 				}
-				else
+				if(host_build)
 				{
-					updateMem(scene_info.buffers[2U], scene_info.memories[0U],
-						scene->materials.data.size() * sizeof(Material), scene->materials.data.data());
+					// Transform only changes keep the topology, so a refit is
+					// enough until the hierarchy quality degrades.
+					bool const wide_traversal { traversal == TraversalModes::Wide };
+					bool rebuild { true };
+					if(!geometry && traversal != TraversalModes::Linear && n_scene_primitives != 0U)
+					{
+						float const ratio { hierarchy.refit(bounds) };
+						rebuild = ratio > refit_threshold;
+						if constexpr(DebugSettings::hierarchy_stats)
+						{
+							std::cout << "Hierarchy refit cost ratio: " << ratio
+								<< (rebuild ? ", rebuilding." : ".") << std::endl;
+						}
+					}
+					if(rebuild)
+					{
+						// World space builds change with every move, so they
+						// never go through the hierarchy cache.
+						auto const start { std::chrono::steady_clock::now() };
+						if(builder == HierarchyBuilders::Spatial)
+						{
+							std::vector<Triangle> triangles(n_scene_primitives);
+							for(std::size_t i { 0U }; i < n_scene_primitives; ++i)
+							{
+								triangles[i] = Hierarchy::primitiveTriangle(scene->primitives.data[i],
+									scene->vertices.data, scene->transforms.data);
+							}
+							hierarchy.buildSpatial(bounds, triangles, spatial_budget);
+						}
+						else
+						{
+							hierarchy.build(bounds);
+						}
+						if constexpr(DebugSettings::hierarchy_stats)
+						{
+							std::chrono::duration<double, std::milli> const time { std::chrono::steady_clock::now() - start };
+							std::cout << "Hierarchy build: " << time.count() << " ms, " << hierarchy.nodes.size()
+								<< " nodes, " << hierarchy.references.size() << " references." << std::endl;
+						}
+						std::vector<std::uint32_t> references { streams.encode(hierarchy.references) };
+						updateSceneMem(5U, references.size() * sizeof(std::uint32_t), references.data());
+					}
+					if(wide_traversal)
+					{
+						// Collapsing is cheap next to the build, refits collapse again.
+						wide.build(hierarchy);
+						updateSceneMem(7U, wide.nodes.size() * sizeof(WideNode), wide.nodes.data());
+						if constexpr(DebugSettings::hierarchy_stats)
+						{
+							std::cout << "Wide hierarchy nodes: " << wide.nodes.size() << " ("
+								<< wide.nodes.size() * sizeof(WideNode) << " bytes), binary nodes: "
+								<< hierarchy.nodes.size() << " (" << hierarchy.nodes.size() * sizeof(Node)
+								<< " bytes)." << std::endl;
+						}
+					}
+					else
+					{
+						updateSceneMem(4U, hierarchy.nodes.size() * sizeof(Node), hierarchy.nodes.data());
+					}
+				}
+				else if constexpr(DebugSettings::validate_hierarchy)
+				{
+					validation_bounds = std::move(bounds);
+					validation_pending = true;
 				}
-				scene->materials.updated = false;
 				update = true;
 			}
+			// Lights follow the geometry, transforms and materials. They are
+			// not part of the geometry, so they leave the update as it is.
+			if(update || lights_outdated)
+			{
+				std::unique_lock<std::mutex> materials_lock(scene->materials.guard);
+				lights.build(scene->entities.data, scene->primitives.data, scene->vertices.data,
+					scene->transforms.data, scene->materials.data);
+				updateSceneMem(12U, lights.records.size() * sizeof(LightRecord), lights.records.data());
+				lights_outdated = false;
+			}
+			scene->entities.updated = false;
+			scene->vertices.updated = false;
+			scene->transforms.updated = false;
+			scene->primitives.updated = false;
+			if constexpr(DebugSettings::hierarchy_stats)
+			{
+				if(update && !cache.directory.empty())
+				{
+					std::cout << "Hierarchy cache hits: " << cache.hits << ", misses: " << cache.misses
+						<< "." << std::endl;
+				}
+			}
+			scene_traversal = traversal;
+			scene_builder = builder;
+			scene_uploaded = true;
 		}
+		return update;
+	}
+	/// <summary>
+	/// Updates scene materials.
+	/// </summary>
+	bool RayTracer::updateMaterials()
+	{
+		std::shared_lock<std::shared_mutex> scene_lock(scene_guard);
+		std::unique_lock<std::mutex> materials_lock(scene->materials.guard);
+		// Materials are updated before the scene, on the same thread.
+		if(!scene->materials.updated && scene_uploaded)
 		{
-			std::unique_lock<std::mutex> primitives_lock(scene->primitives.guard);
-			if(scene->primitives.updated)
+			return false;
+		}
+		updateSceneMem(2U, scene->materials.data.size() * sizeof(Material), scene->materials.data.data());
+		scene->materials.updated = false;
+		// Emissive materials decide the lights.
+		lights_outdated = true;
+		return true;
+	}
+	/// <summary>
+	/// Uploads the primitive streams and the stream reference of each
+	/// primitive.
+	/// </summary>
+	void RayTracer::updateStreamsMem()
+	{
+		updateSceneMem(8U, streams.spheres.size() * sizeof(SphereRecord), streams.spheres.data());
+		updateSceneMem(9U, streams.cuboids.size() * sizeof(CuboidRecord), streams.cuboids.data());
+		updateSceneMem(10U, streams.triangles.size() * sizeof(TriangleRecord), streams.triangles.data());
+		updateSceneMem(11U, streams.references.size() * sizeof(std::uint32_t), streams.references.data());
+	}
+	/// <summary>
+	/// Stages an update of a scene info buffer, written to the staging slot
+	/// of the next upload and copied to the device with it. Scene info
+	/// updates run in sequence, on the same job.
+	/// </summary>
+	void RayTracer::updateSceneMem(std::size_t const idx, vk::DeviceSize size, void * data)
+	{
+		if(size == 0U) { return; }
+		// Each buffer is written at most once per upload, so a slot holds them all.
+		if(staging_head + size > staging_slot_size)
+		{
+			throw std::exception("Staging slot overflow. [Scene info]");
+		}
+		vk::DeviceSize const offset { staging_slot * staging_slot_size + staging_head };
+		std::memcpy(static_cast<std::byte *>(staging_data) + offset, data, size);
+		staged_copies[idx].push_back(vk::BufferCopy { offset, 0U, size });
+		staging_head += size;
+	}
+	/// <summary>
+	/// Reads back the hierarchy nodes or references scene info buffer, from
+	/// the copy the last device build left in host memory.
+	/// </summary>
+	void RayTracer::readSceneMem(std::size_t const idx, vk::DeviceSize size, void * data)
+	{
+		vk::DescriptorBufferInfo const & readback { scene_readback.buffers[idx == 4U ? 0U : 1U] };
+		vk::DeviceMemory & memory { scene_readback.memories[0U] };
+		void * mem { nullptr };
+		vk::Result result { device.mapMemory(memory, readback.offset, readback.range, {}, &mem, dispatch) };
+		if(result != vk::Result::eSuccess)
+		{ vk::throwResultException(result, "Memory map"); }
+		if(mem)
+		{
+			std::memcpy(data, mem, size);
+			device.unmapMemory(memory, dispatch);
+		}
+	}
+	/// <summary>
+	/// Checks the last device built hierarchy against a host built
+	/// reference over the same boxes and outputs any differences. Every
+	/// device node box must contain its children, or the boxes of its
+	/// referenced primitives, and both hierarchies must hold the same
+	/// references. Boxes are compared with a small tolerance, as the device
+	/// transforms vertices on its own.
+	/// </summary>
+	void RayTracer::validateHierarchy()
+	{
+		if(validation_bounds.empty()) { return; }
+		Hierarchy reference {};
+		reference.buildLinear(validation_bounds);
+		std::vector<Node> nodes(reference.nodes.size());
+		std::vector<std::uint32_t> references(reference.references.size());
+		readSceneMem(4U, nodes.size() * sizeof(Node), nodes.data());
+		readSceneMem(5U, references.size() * sizeof(std::uint32_t), references.data());
+
+		auto const contains = [](Node const & node, Bounds const & bounds)
+		{
+			if(!bounds.valid()) { return true; }
+			glm::vec3 const tolerance { 0.001f * (glm::vec3(1.0f) + glm::abs(bounds.min) + glm::abs(bounds.max)) };
+			return glm::all(glm::lessThanEqual(node.min - tolerance, bounds.min)) &&
+				glm::all(glm::greaterThanEqual(node.max + tolerance, bounds.max));
+		};
+		// Device references point into the primitive streams.
+		std::unordered_map<std::uint32_t, std::uint32_t> primitives {};
+		for(std::uint32_t i { 0U }; i < validation_bounds.size(); ++i)
+		{
+			primitives.emplace(streams.references[i], i);
+		}
+		std::size_t node_errors { 0U }, reference_errors { 0U };
+		for(std::size_t i { 0U }; i < nodes.size(); ++i)
+		{
+			Node const & node { nodes[i] };
+			bool valid { true };
+			if(node.left & Hierarchy::leaf_flag)
 			{
-				if constexpr(DebugSettings::split_memory)
+				std::size_t const first { node.left & ~Hierarchy::leaf_flag };
+				for(std::size_t j { first }; valid && j < first + node.right; ++j)
 				{
-					updateMem(scene_info.buffers[3U], scene_info.memories[3U],
-						n_primitives * sizeof(Primitive), scene->primitives.data.data());
+					auto const primitive { j < references.size() ? primitives.find(references[j]) : primitives.end() };
+					valid = primitive != primitives.end() && contains(node, validation_bounds[primitive->second]);
 				}
-				else
+			}
+			else
+			{
+				for(std::uint32_t const child : { node.left, node.right })
 				{
-					updateMem(scene_info.buffers[3U], scene_info.memories[0U],
-						n_primitives * sizeof(Primitive), scene->primitives.data.data());
+					valid = valid && child < nodes.size() &&
+						contains(node, Bounds { nodes[child].min, nodes[child].max });
 				}
-				scene->primitives.updated = false;
-				update = true;
 			}
+			if(!valid) { ++node_errors; }
+		}
+		std::vector<std::uint32_t> expected { streams.encode(reference.references) };
+		std::sort(references.begin(), references.end());
+		std::sort(expected.begin(), expected.end());
+		for(std::size_t i { 0U }; i < references.size(); ++i)
+		{
+			if(references[i] != expected[i]) { ++reference_errors; }
+		}
+		if(node_errors || reference_errors)
+		{
+			std::cout << "Device hierarchy differs from reference: " << node_errors << " of "
+				<< nodes.size() << " nodes, " << reference_errors << " of "
+				<< references.size() << " references." << std::endl;
 		}
-		return update;
 	}
 	/// <summary>
 	/// Updates the device memory
@@ -361,17 +1325,42 @@ namespace Aura::Core
 	// Resources.
 	// ------------------------------------------------------------------ //
 	/// <summary>
+	/// Checks the sample batch against the device limits, before any resource
+	/// is set up. Rays state buffers are bound whole and grow with the batch,
+	/// the largest must fit a storage buffer binding. Full queues must fit the
+	/// rows of work groups they are dispatched in.
+	/// </summary>
+	void RayTracer::validateBatch() const
+	{
+		vk::PhysicalDeviceProperties properties {};
+		physical_device.getProperties(&properties, dispatch);
+
+		std::size_t const n_rays { static_cast<std::size_t>(tile_width) * tile_height * batch };
+		std::size_t const ray_size { std::max({ sizeof(Ray), sizeof(Hit), sizeof(Pixel), sizeof(ShadowRay),
+			sizeof(std::uint32_t) * n_ray_queues }) };
+		std::size_t const n_groups { (n_rays + intersect_gsize[0U] - 1U) / intersect_gsize[0U] };
+		if(ray_size * n_rays > properties.limits.maxStorageBufferRange)
+		{
+			throw std::exception("Sample batch exceeds the storage buffer range. [Rays state]");
+		}
+		if((n_groups + queue_row - 1U) / queue_row > properties.limits.maxComputeWorkGroupCount[1U])
+		{
+			throw std::exception("Sample batch exceeds the work group count. [Rays state]");
+		}
+	}
+	/// <summary>
 	/// Sets up the descriptor pool and bulk sets-up all the resources needed.
 	/// </summary>
 	void RayTracer::setUpResources(ThreadPool & thread_pool)
 	{
 		setUpDescriptorPool();
 
-		std::array<std::future<void>, 4U> const jobs {
+		std::array<std::future<void>, 5U> const jobs {
 			thread_pool.enqueue([&] { setUpRenderSettings(); }),
 			thread_pool.enqueue([&] { setUpRayLauncher(); }),
 			thread_pool.enqueue([&] { setUpRaysState(); }),
-			thread_pool.enqueue([&] { setUpSceneInfo(); })
+			thread_pool.enqueue([&] { setUpSceneInfo(); }),
+			thread_pool.enqueue([&] { setUpBuildState(); })
 		};
 
 		for(std::size_t i { 0U }; i < jobs.size(); ++i)
@@ -380,11 +1369,17 @@ namespace Aura::Core
 			jobs[i].wait();
 		}
 		allocateAllDescriptorSets();
+		setUpIntersectQueries();
+		setUpActiveCounts();
+		// Sized after the scene info buffers.
+		setUpStaging();
+		setUpSceneReadback();
 
 		updateRenderSettingsSet();
 		updateRayLauncherSet();
 		updateRaysState();
 		updateSceneInfo();
+		updateBuildStateSet();
 	}
 	/// <summary>
 	/// Bulk tears-down all set-up resources, as well as, the descriptor pool.
@@ -395,6 +1390,11 @@ namespace Aura::Core
 		tearDownRaysState();
 		tearDownRayLauncher();
 		tearDownSceneInfo();
+		tearDownStaging();
+		tearDownSceneReadback();
+		tearDownBuildState();
+		tearDownIntersectQueries();
+		tearDownActiveCounts();
 		tearDownDescriptorPool();
 	}
 	/// <summary>
@@ -409,7 +1409,11 @@ namespace Aura::Core
 		layouts.emplace_back(render_settings.set_layout);
 		layouts.emplace_back(ray_launcher.set_layout);
 		layouts.emplace_back(rays_state.set_layout);
-		layouts.emplace_back(scene_info.set_layout);
+		for(std::uint32_t i { 0U }; i < scene_copies; ++i)
+		{
+			layouts.emplace_back(scene_info[0U].set_layout);
+		}
+		layouts.emplace_back(build_state.set_layout);
 
 		sets.resize(layouts.size());
 		allocateDescriptorSets(pool, static_cast<std::uint32_t>(layouts.size()), layouts.data(), sets.data());
@@ -418,19 +1422,21 @@ namespace Aura::Core
 		render_settings.set = sets[1U];
 		ray_launcher.set = sets[2U];
 		rays_state.set = sets[3U];
-		scene_info.set = sets[4U];
+		scene_info[0U].set = sets[4U];
+		scene_info[1U].set = sets[5U];
+		build_state.set = sets[6U];
 	}
 	/// <summary>
 	/// Sets up the descriptor pool for all resources.
 	/// </summary>
 	void RayTracer::setUpDescriptorPool()
 	{
-		constexpr std::uint32_t n_sets { 5U };
+		constexpr std::uint32_t n_sets { 7U };
 		constexpr std::uint32_t n_sizes { 3U };
 		std::array<vk::DescriptorPoolSize, n_sizes> sizes {
 			// - Descriptor type and count.
 			vk::DescriptorPoolSize { vk::DescriptorType::eStorageImage, 1U },
-			vk::DescriptorPoolSize { vk::DescriptorType::eStorageBuffer, 8U },
+			vk::DescriptorPoolSize { vk::DescriptorType::eStorageBuffer, 44U },
 			vk::DescriptorPoolSize { vk::DescriptorType::eUniformBuffer, 2U } };
 		createDescriptorPool({}, n_sets, n_sizes, sizes.data(), pool);
 	}
@@ -567,7 +1573,7 @@ namespace Aura::Core
 	/// </summary>
 	void RayTracer::setUpRaysState()
 	{
-		constexpr std::uint32_t n_buffers { 3U };
+		constexpr std::uint32_t n_buffers { 13U };
 
 		std::array<vk::DescriptorSetLayoutBinding, n_buffers> const binds {
 			// - Binding number, descriptor type and count.
@@ -577,14 +1583,68 @@ namespace Aura::Core
 			vk::DescriptorSetLayoutBinding { 1U, vk::DescriptorType::eStorageBuffer, 1U,
 				vk::ShaderStageFlagBits::eCompute, nullptr },
 			vk::DescriptorSetLayoutBinding { 2U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 3U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 4U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 5U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 6U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 7U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 8U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 9U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 10U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 11U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 12U, vk::DescriptorType::eStorageBuffer, 1U,
 				vk::ShaderStageFlagBits::eCompute, nullptr } };
 		createDescriptorSetLayout({}, n_buffers, binds.data(), rays_state.set_layout);
 
+		// Every sample of the batch has its own slice of rays, hits and pixels.
+		std::size_t const n_rays { static_cast<std::size_t>(tile_width) * tile_height * batch };
 		std::array<vk::DeviceSize, n_buffers> sizes {
-			static_cast<vk::DeviceSize>(sizeof(Ray) * width * height),
-			static_cast<vk::DeviceSize>(sizeof(Hit) * width * height),
-			static_cast<vk::DeviceSize>(sizeof(Pixel) * width * height)
+			static_cast<vk::DeviceSize>(sizeof(Ray) * n_rays),
+			static_cast<vk::DeviceSize>(sizeof(Hit) * n_rays),
+			static_cast<vk::DeviceSize>(sizeof(Pixel) * n_rays),
+			// One occlusion bit per ray.
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * ((n_rays + 31U) / 32U)),
+			// Ray indices of each queue.
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * n_rays * n_ray_queues),
+			static_cast<vk::DeviceSize>(sizeof(RayQueue) * n_ray_queues),
+			// Material sorted ray indices, then each bucket count and cursor.
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * n_rays),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * n_material_buckets * 2U),
+			// Ray sort origins bounds, then each bucket count and cursor.
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * (8U + n_ray_buckets * 2U)),
+			// Megakernel next pixel counter.
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t)),
+			// Adaptive sampling squared luminance sums, sliced as the pixels,
+			// then the mask of the pixels still sampled.
+			static_cast<vk::DeviceSize>(sizeof(float) * n_rays),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * tile_width * tile_height),
+			// Shadow ray of each ray, towards its sampled light point.
+			static_cast<vk::DeviceSize>(sizeof(ShadowRay) * n_rays)
 		};
+		// Queue sizes double as dispatch arguments and are reset by transfers.
+		vk::BufferUsageFlags const queue_args_usage { vk::BufferUsageFlagBits::eStorageBuffer
+			| vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst
+			| vk::BufferUsageFlagBits::eTransferSrc };
+		std::array<vk::BufferUsageFlags, n_buffers> const usages {
+			vk::BufferUsageFlagBits::eStorageBuffer, vk::BufferUsageFlagBits::eStorageBuffer,
+			// Pixels are copied back to the host on request.
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+			vk::BufferUsageFlagBits::eStorageBuffer, vk::BufferUsageFlagBits::eStorageBuffer, queue_args_usage, vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::BufferUsageFlagBits::eStorageBuffer, vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::BufferUsageFlagBits::eStorageBuffer };
 		rays_state.buffers.resize(n_buffers);
 
 		vk::MemoryPropertyFlags const required { vk::MemoryPropertyFlagBits::eDeviceLocal };
@@ -599,7 +1659,7 @@ namespace Aura::Core
 				vk::MemoryRequirements mem {};
 				std::uint32_t mem_type { 0U };
 
-				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, rays_state.buffers[i].buffer);
+				createBuffer({}, sizes[i], usages[i], 1U, &compute_family, rays_state.buffers[i].buffer);
 				device.getBufferMemoryRequirements(rays_state.buffers[i].buffer, &mem, dispatch);
 				if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
 				{
@@ -617,86 +1677,443 @@ namespace Aura::Core
 			rays_state.memories.resize(1U);
 			for(std::size_t i { 0U }; i < n_buffers; ++i)
 			{
-				vk::MemoryRequirements mem {};
-				std::uint32_t mem_type { 0U };
-
-				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, rays_state.buffers[i].buffer);
-				device.getBufferMemoryRequirements(rays_state.buffers[i].buffer, &mem, dispatch);
-				if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
-				{
-					throw std::exception("No memory with required properties. [Rays state]");
-				}
-				if(i == 0)
-				{
-					type_bits = mem_type;
-				}
-				else if(mem_type != type_bits)
+				vk::MemoryRequirements mem {};
+				std::uint32_t mem_type { 0U };
+
+				createBuffer({}, sizes[i], usages[i], 1U, &compute_family, rays_state.buffers[i].buffer);
+				device.getBufferMemoryRequirements(rays_state.buffers[i].buffer, &mem, dispatch);
+				if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
+				{
+					throw std::exception("No memory with required properties. [Rays state]");
+				}
+				if(i == 0)
+				{
+					type_bits = mem_type;
+				}
+				else if(mem_type != type_bits)
+				{
+					throw std::exception("Memory type bits are different, case not implemented. [Rays state]");
+				}
+				rays_state.buffers[i].offset = total_size;
+				rays_state.buffers[i].range = sizes[i];
+				total_size += mem.size;
+			}
+
+			allocateMemory(total_size, type_bits, rays_state.memories[0U]);
+			for(std::size_t i { 0U }; i < n_buffers; ++i)
+			{
+				device.bindBufferMemory(rays_state.buffers[i].buffer, rays_state.memories[0U],
+					rays_state.buffers[i].offset, dispatch);
+			}
+		}
+	}
+	/// <summary>
+	/// Update rays and hits set. This isn't mutable, and should only be
+	/// used once.
+	/// </summary>
+	void RayTracer::updateRaysState()
+	{
+		constexpr std::uint32_t n_buffers { 13U };
+
+		std::array<vk::DescriptorBufferInfo, n_buffers> buffers {
+			rays_state.buffers[0U], rays_state.buffers[1U], rays_state.buffers[2U], rays_state.buffers[3U],
+			rays_state.buffers[4U], rays_state.buffers[5U], rays_state.buffers[6U], rays_state.buffers[7U],
+			rays_state.buffers[8U], rays_state.buffers[9U], rays_state.buffers[10U], rays_state.buffers[11U],
+			rays_state.buffers[12U] };
+		buffers[0U].offset = 0U;
+		buffers[1U].offset = 0U;
+		buffers[2U].offset = 0U;
+		buffers[3U].offset = 0U;
+		buffers[4U].offset = 0U;
+		buffers[5U].offset = 0U;
+		buffers[6U].offset = 0U;
+		buffers[7U].offset = 0U;
+		buffers[8U].offset = 0U;
+		buffers[9U].offset = 0U;
+		buffers[10U].offset = 0U;
+		buffers[11U].offset = 0U;
+		buffers[12U].offset = 0U;
+		std::array<vk::WriteDescriptorSet, n_buffers> const writes {
+			// - Destination set, binding and array element, count.
+			// - Type and info(Image, Buffer, Texel).
+			vk::WriteDescriptorSet{rays_state.set, 0U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[0U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 1U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[1U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 2U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[2U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 3U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[3U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 4U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[4U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 5U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[5U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 6U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[6U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 7U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[7U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 8U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[8U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 9U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[9U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 10U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[10U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 11U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[11U], nullptr},
+			vk::WriteDescriptorSet{rays_state.set, 12U, 0U, 1U,
+				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[12U], nullptr}
+		};
+		device.updateDescriptorSets(n_buffers, writes.data(), 0U, nullptr, dispatch);
+	}
+	/// <summary>
+	/// Destroys the rays and hits layout, buffers and memory.
+	/// </summary>
+	void RayTracer::tearDownRaysState()
+	{
+		constexpr std::uint32_t n_buffers { 13U };
+
+		for(std::size_t i { 0U }; i < n_buffers; ++i)
+		{
+			destroyBuffer(rays_state.buffers[i].buffer);
+			if constexpr(DebugSettings::split_memory)
+			{
+				freeMemory(rays_state.memories[i]);
+			}
+		}
+		if constexpr(!DebugSettings::split_memory)
+		{
+			freeMemory(rays_state.memories[0U]);
+		}
+		destroyDescriptorSetLayout(rays_state.set_layout);
+	}
+	/// <summary>
+	/// Prepares scene info layout, and the buffers and memory of each copy.
+	/// </summary>
+	void RayTracer::setUpSceneInfo()
+	{
+		constexpr std::uint32_t n_buffers { 13U };
+
+		std::array<vk::DescriptorSetLayoutBinding, n_buffers> const binds {
+			// - Binding number, descriptor type and count.
+			// - Shader stage and sampler.
+			vk::DescriptorSetLayoutBinding { 0U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 1U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 2U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 3U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 4U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 5U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 6U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 7U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 8U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 9U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 10U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 11U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr },
+			vk::DescriptorSetLayoutBinding { 12U, vk::DescriptorType::eStorageBuffer, 1U,
+				vk::ShaderStageFlagBits::eCompute, nullptr } };
+		createDescriptorSetLayout({}, n_buffers, binds.data(), scene_info[0U].set_layout);
+
+		std::array<vk::DeviceSize, n_buffers> sizes {
+			static_cast<vk::DeviceSize>(sizeof(Vertex) * EnvLimits::limit_vertices),
+			static_cast<vk::DeviceSize>(sizeof(Transform) * EnvLimits::limit_entities),
+			static_cast<vk::DeviceSize>(sizeof(Material) * EnvLimits::limit_materials),
+			static_cast<vk::DeviceSize>(sizeof(Primitive) * EnvLimits::limit_primitives),
+			// Spatial splits may double the references, and so the nodes.
+			static_cast<vk::DeviceSize>(sizeof(Node) *
+				(TwoLevelHierarchy::top_nodes + 4U * EnvLimits::limit_primitives)),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) *
+				(TwoLevelHierarchy::top_references + 2U * EnvLimits::limit_primitives)),
+			static_cast<vk::DeviceSize>(sizeof(Instance) * EnvLimits::limit_entities),
+			static_cast<vk::DeviceSize>(sizeof(WideNode) * 2U * EnvLimits::limit_primitives),
+			// Per type primitive streams and the stream reference of each primitive.
+			static_cast<vk::DeviceSize>(sizeof(SphereRecord) * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(CuboidRecord) * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(TriangleRecord) * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * EnvLimits::limit_primitives),
+			// Emissive surfaces, sampled by next event estimation.
+			static_cast<vk::DeviceSize>(sizeof(LightRecord) * EnvLimits::limit_lights)
+		};
+		staged_copies.resize(n_buffers);
+		replayed_copies.resize(n_buffers);
+
+		// Scene info is read on every bounce, so it lives on the device and
+		// is only written through the staging ring. Hierarchy validation
+		// copies the built nodes and references back.
+		vk::BufferUsageFlags const usage { vk::BufferUsageFlagBits::eStorageBuffer |
+			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc };
+		vk::MemoryPropertyFlags const required { vk::MemoryPropertyFlagBits::eDeviceLocal };
+
+		// Each copy has its own memory, frames read one while the other is
+		// uploaded.
+		for(Resource & copy : scene_info)
+		{
+			copy.buffers.resize(n_buffers);
+			vk::DeviceSize total_size { 0U };
+			std::uint32_t type_bits { 0U };
+
+			if constexpr(DebugSettings::split_memory)
+			{
+				copy.memories.resize(n_buffers);
+				for(std::size_t i { 0U }; i < n_buffers; ++i)
+				{
+					vk::MemoryRequirements mem {};
+					std::uint32_t mem_type { 0U };
+
+					createBuffer({}, sizes[i], usage, 1U, &compute_family, copy.buffers[i].buffer);
+					device.getBufferMemoryRequirements(copy.buffers[i].buffer, &mem, dispatch);
+					if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
+					{
+						throw std::exception("No memory with required properties. [Rays state]");
+					}
+					copy.buffers[i].offset = 0;
+					copy.buffers[i].range = sizes[i];
+					allocateMemory(mem.size, mem_type, copy.memories[i]);
+					device.bindBufferMemory(copy.buffers[i].buffer, copy.memories[i],
+						copy.buffers[i].offset, dispatch);
+				}
+			}
+			else
+			{
+				copy.memories.resize(1U);
+				for(std::size_t i { 0U }; i < n_buffers; ++i)
+				{
+					vk::MemoryRequirements mem {};
+					std::uint32_t mem_type { 0U };
+
+					createBuffer({}, sizes[i], usage, 1U, &compute_family, copy.buffers[i].buffer);
+					device.getBufferMemoryRequirements(copy.buffers[i].buffer, &mem, dispatch);
+					if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
+					{
+						throw std::exception("No memory with required properties. [Rays state]");
+					}
+					if(i == 0)
+					{
+						type_bits = mem_type;
+					}
+					else if(mem_type != type_bits)
+					{
+						throw std::exception("Memory type bits are different, case not implemented. [Rays state]");
+					}
+					copy.buffers[i].offset = total_size;
+					copy.buffers[i].range = sizes[i];
+					total_size += mem.size;
+				}
+
+				allocateMemory(total_size, type_bits, copy.memories[0U]);
+				for(std::size_t i { 0U }; i < n_buffers; ++i)
+				{
+					device.bindBufferMemory(copy.buffers[i].buffer, copy.memories[0U],
+						copy.buffers[i].offset, dispatch);
+				}
+			}
+		}
+	}
+	/// <summary>
+	/// Update scene info sets, each to its copy. This isn't mutable, and
+	/// should only be used once.
+	/// </summary>
+	void RayTracer::updateSceneInfo()
+	{
+		constexpr std::uint32_t n_buffers { 13U };
+
+		for(Resource const & copy : scene_info)
+		{
+			std::array<vk::DescriptorBufferInfo, n_buffers> buffers {
+				copy.buffers[0U], copy.buffers[1U],
+				copy.buffers[2U], copy.buffers[3U],
+				copy.buffers[4U], copy.buffers[5U],
+				copy.buffers[6U], copy.buffers[7U],
+				copy.buffers[8U], copy.buffers[9U],
+				copy.buffers[10U], copy.buffers[11U],
+				copy.buffers[12U] };
+			buffers[0U].offset = 0U;
+			buffers[1U].offset = 0U;
+			buffers[2U].offset = 0U;
+			buffers[3U].offset = 0U;
+			buffers[4U].offset = 0U;
+			buffers[5U].offset = 0U;
+			buffers[6U].offset = 0U;
+			buffers[7U].offset = 0U;
+			buffers[8U].offset = 0U;
+			buffers[9U].offset = 0U;
+			buffers[10U].offset = 0U;
+			buffers[11U].offset = 0U;
+			buffers[12U].offset = 0U;
+			std::array<vk::WriteDescriptorSet, n_buffers> const writes {
+				// - Destination set, binding and array element, count.
+				// - Type and info(Image, Buffer, Texel).
+				vk::WriteDescriptorSet{copy.set, 0U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[0U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 1U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[1U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 2U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[2U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 3U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[3U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 4U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[4U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 5U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[5U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 6U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[6U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 7U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[7U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 8U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[8U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 9U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[9U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 10U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[10U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 11U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[11U], nullptr},
+				vk::WriteDescriptorSet{copy.set, 12U, 0U, 1U,
+					vk::DescriptorType::eStorageBuffer, nullptr, &buffers[12U], nullptr}
+			};
+			device.updateDescriptorSets(n_buffers, writes.data(), 0U, nullptr, dispatch);
+		}
+	}
+	/// <summary>
+	/// Destroys the scene info layout, and the buffers and memory of each
+	/// copy.
+	/// </summary>
+	void RayTracer::tearDownSceneInfo()
+	{
+		constexpr std::uint32_t n_buffers { 13U };
+
+		for(Resource & copy : scene_info)
+		{
+			for(std::size_t i { 0U }; i < n_buffers; ++i)
+			{
+				destroyBuffer(copy.buffers[i].buffer);
+				if constexpr(DebugSettings::split_memory)
 				{
-					throw std::exception("Memory type bits are different, case not implemented. [Rays state]");
+					freeMemory(copy.memories[i]);
 				}
-				rays_state.buffers[i].offset = total_size;
-				rays_state.buffers[i].range = sizes[i];
-				total_size += mem.size;
 			}
-
-			allocateMemory(total_size, type_bits, rays_state.memories[0U]);
-			for(std::size_t i { 0U }; i < n_buffers; ++i)
+			if constexpr(!DebugSettings::split_memory)
 			{
-				device.bindBufferMemory(rays_state.buffers[i].buffer, rays_state.memories[0U],
-					rays_state.buffers[i].offset, dispatch);
+				freeMemory(copy.memories[0U]);
 			}
 		}
+		destroyDescriptorSetLayout(scene_info[0U].set_layout);
 	}
 	/// <summary>
-	/// Update rays and hits set. This isn't mutable, and should only be
-	/// used once.
+	/// Prepares the scene info staging ring buffer and its mapped memory.
+	/// Each slot fits every scene info buffer of a copy, so any staged
+	/// updates fit a slot.
 	/// </summary>
-	void RayTracer::updateRaysState()
+	void RayTracer::setUpStaging()
 	{
-		constexpr std::uint32_t n_buffers { 3U };
+		staging_slot_size = 0U;
+		for(vk::DescriptorBufferInfo const & buffer : scene_info[0U].buffers)
+		{
+			staging_slot_size += buffer.range;
+		}
+		vk::DeviceSize const staging_size { staging_slots * staging_slot_size };
+		vk::Buffer buffer {};
+		createBuffer({}, staging_size, vk::BufferUsageFlagBits::eTransferSrc, 1U, &transfer_family, buffer);
+		vk::MemoryRequirements mem {};
+		device.getBufferMemoryRequirements(buffer, &mem, dispatch);
 
-		std::array<vk::DescriptorBufferInfo, n_buffers> buffers {
-			rays_state.buffers[0U], rays_state.buffers[1U], rays_state.buffers[2U] };
-		buffers[0U].offset = 0U;
-		buffers[1U].offset = 0U;
-		buffers[2U].offset = 0U;
-		std::array<vk::WriteDescriptorSet, n_buffers> const writes {
-			// - Destination set, binding and array element, count.
-			// - Type and info(Image, Buffer, Texel).
-			vk::WriteDescriptorSet{rays_state.set, 0U, 0U, 1U,
-				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[0U], nullptr},
-			vk::WriteDescriptorSet{rays_state.set, 1U, 0U, 1U,
-				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[1U], nullptr},
-			vk::WriteDescriptorSet{rays_state.set, 2U, 0U, 1U,
-				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[2U], nullptr}
-		};
-		device.updateDescriptorSets(n_buffers, writes.data(), 0U, nullptr, dispatch);
+		staging.buffers.resize(1U);
+		staging.buffers[0U].buffer = buffer;
+		staging.buffers[0U].range = staging_size;
+		staging.buffers[0U].offset = 0U;
+
+		vk::MemoryPropertyFlags const required {
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+		std::uint32_t type_index { 0U };
+		if(!findMemoryType(mem.memoryTypeBits, required, type_index))
+		{
+			throw std::exception("No memory with required properties. [Staging]");
+		}
+
+		staging.memories.resize(1U);
+		allocateMemory(mem.size, type_index, staging.memories[0U]);
+		device.bindBufferMemory(staging.buffers[0U].buffer, staging.memories[0U],
+			staging.buffers[0U].offset, dispatch);
+		// Updates are written straight into the slots, the memory stays mapped.
+		vk::Result const result { device.mapMemory(staging.memories[0U], 0U,
+			staging_size, {}, &staging_data, dispatch) };
+		if(result != vk::Result::eSuccess)
+		{ vk::throwResultException(result, "Memory map"); }
+		staging_slot = 0U;
+		staging_head = 0U;
 	}
 	/// <summary>
-	/// Destroys the rays and hits layout, buffers and memory.
+	/// Destroys the scene info staging ring buffer and memory.
 	/// </summary>
-	void RayTracer::tearDownRaysState()
+	void RayTracer::tearDownStaging()
 	{
-		constexpr std::uint32_t n_buffers { 3U };
-
-		for(std::size_t i { 0U }; i < n_buffers; ++i)
+		device.unmapMemory(staging.memories[0U], dispatch);
+		staging_data = nullptr;
+		destroyBuffer(staging.buffers[0U].buffer);
+		freeMemory(staging.memories[0U]);
+	}
+	/// <summary>
+	/// Prepares the hierarchy validation read back buffer and memory, a
+	/// region for the nodes and one for the references.
+	/// </summary>
+	void RayTracer::setUpSceneReadback()
+	{
+		if constexpr(DebugSettings::validate_hierarchy)
 		{
-			destroyBuffer(rays_state.buffers[i].buffer);
-			if constexpr(DebugSettings::split_memory)
+			vk::DeviceSize const nodes_size { scene_info[0U].buffers[4U].range };
+			vk::DeviceSize const references_size { scene_info[0U].buffers[5U].range };
+			vk::Buffer buffer {};
+			createBuffer({}, nodes_size + references_size, vk::BufferUsageFlagBits::eTransferDst,
+				1U, &compute_family, buffer);
+			vk::MemoryRequirements mem {};
+			device.getBufferMemoryRequirements(buffer, &mem, dispatch);
+
+			scene_readback.buffers.resize(2U);
+			scene_readback.buffers[0U].buffer = buffer;
+			scene_readback.buffers[0U].range = nodes_size;
+			scene_readback.buffers[0U].offset = 0U;
+			scene_readback.buffers[1U].buffer = buffer;
+			scene_readback.buffers[1U].range = references_size;
+			scene_readback.buffers[1U].offset = nodes_size;
+
+			vk::MemoryPropertyFlags const required {
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+			std::uint32_t type_index { 0U };
+			if(!findMemoryType(mem.memoryTypeBits, required, type_index))
 			{
-				freeMemory(rays_state.memories[i]);
+				throw std::exception("No memory with required properties. [Scene readback]");
 			}
+
+			scene_readback.memories.resize(1U);
+			allocateMemory(mem.size, type_index, scene_readback.memories[0U]);
+			device.bindBufferMemory(buffer, scene_readback.memories[0U], 0U, dispatch);
 		}
-		if constexpr(!DebugSettings::split_memory)
+	}
+	/// <summary>
+	/// Destroys the hierarchy validation read back buffer and memory.
+	/// </summary>
+	void RayTracer::tearDownSceneReadback()
+	{
+		if constexpr(DebugSettings::validate_hierarchy)
 		{
-			freeMemory(rays_state.memories[0U]);
+			destroyBuffer(scene_readback.buffers[0U].buffer);
+			freeMemory(scene_readback.memories[0U]);
 		}
-		destroyDescriptorSetLayout(rays_state.set_layout);
 	}
+
 	/// <summary>
-	/// Prepares scene info layout, buffers and memory.
+	/// Prepares the device hierarchy build layout, buffers and memory.
 	/// </summary>
-	void RayTracer::setUpSceneInfo()
+	void RayTracer::setUpBuildState()
 	{
 		constexpr std::uint32_t n_buffers { 4U };
 
@@ -711,56 +2128,55 @@ namespace Aura::Core
 				vk::ShaderStageFlagBits::eCompute, nullptr },
 			vk::DescriptorSetLayoutBinding { 3U, vk::DescriptorType::eStorageBuffer, 1U,
 				vk::ShaderStageFlagBits::eCompute, nullptr } };
-		createDescriptorSetLayout({}, n_buffers, binds.data(), scene_info.set_layout);
+		createDescriptorSetLayout({}, n_buffers, binds.data(), build_state.set_layout);
 
+		// Primitive boxes, sort keys in two halves, node parents and refit flags.
 		std::array<vk::DeviceSize, n_buffers> sizes {
-			static_cast<vk::DeviceSize>(sizeof(Vertex) * EnvLimits::limit_vertices),
-			static_cast<vk::DeviceSize>(sizeof(Transform) * EnvLimits::limit_entities),
-			static_cast<vk::DeviceSize>(sizeof(Material) * EnvLimits::limit_materials),
-			static_cast<vk::DeviceSize>(sizeof(Primitive) * EnvLimits::limit_primitives)
+			static_cast<vk::DeviceSize>(sizeof(glm::vec4) * 2U * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(glm::uvec2) * 2U * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * 2U * EnvLimits::limit_primitives),
+			static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * EnvLimits::limit_primitives)
 		};
-		scene_info.buffers.resize(n_buffers);
+		build_state.buffers.resize(n_buffers);
 
-		vk::MemoryPropertyFlags const required {
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+		vk::MemoryPropertyFlags const required { vk::MemoryPropertyFlagBits::eDeviceLocal };
 		vk::DeviceSize total_size { 0U };
 		std::uint32_t type_bits { 0U };
 
-
 		if constexpr(DebugSettings::split_memory)
 		{
-			scene_info.memories.resize(n_buffers);
+			build_state.memories.resize(n_buffers);
 			for(std::size_t i { 0U }; i < n_buffers; ++i)
 			{
 				vk::MemoryRequirements mem {};
 				std::uint32_t mem_type { 0U };
 
-				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, scene_info.buffers[i].buffer);
-				device.getBufferMemoryRequirements(scene_info.buffers[i].buffer, &mem, dispatch);
+				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, build_state.buffers[i].buffer);
+				device.getBufferMemoryRequirements(build_state.buffers[i].buffer, &mem, dispatch);
 				if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
 				{
-					throw std::exception("No memory with required properties. [Rays state]");
+					throw std::exception("No memory with required properties. [Build state]");
 				}
-				scene_info.buffers[i].offset = 0;
-				scene_info.buffers[i].range = sizes[i];
-				allocateMemory(mem.size, mem_type, scene_info.memories[i]);
-				device.bindBufferMemory(scene_info.buffers[i].buffer, scene_info.memories[i],
-					scene_info.buffers[i].offset, dispatch);
+				build_state.buffers[i].offset = 0;
+				build_state.buffers[i].range = sizes[i];
+				allocateMemory(mem.size, mem_type, build_state.memories[i]);
+				device.bindBufferMemory(build_state.buffers[i].buffer, build_state.memories[i],
+					build_state.buffers[i].offset, dispatch);
 			}
 		}
 		else
 		{
-			scene_info.memories.resize(1U);
+			build_state.memories.resize(1U);
 			for(std::size_t i { 0U }; i < n_buffers; ++i)
 			{
 				vk::MemoryRequirements mem {};
 				std::uint32_t mem_type { 0U };
 
-				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, scene_info.buffers[i].buffer);
-				device.getBufferMemoryRequirements(scene_info.buffers[i].buffer, &mem, dispatch);
+				createBuffer({}, sizes[i], vk::BufferUsageFlagBits::eStorageBuffer, 1U, &compute_family, build_state.buffers[i].buffer);
+				device.getBufferMemoryRequirements(build_state.buffers[i].buffer, &mem, dispatch);
 				if(!findMemoryType(mem.memoryTypeBits, required, mem_type))
 				{
-					throw std::exception("No memory with required properties. [Rays state]");
+					throw std::exception("No memory with required properties. [Build state]");
 				}
 				if(i == 0)
 				{
@@ -768,32 +2184,32 @@ namespace Aura::Core
 				}
 				else if(mem_type != type_bits)
 				{
-					throw std::exception("Memory type bits are different, case not implemented. [Rays state]");
+					throw std::exception("Memory type bits are different, case not implemented. [Build state]");
 				}
-				scene_info.buffers[i].offset = total_size;
-				scene_info.buffers[i].range = sizes[i];
+				build_state.buffers[i].offset = total_size;
+				build_state.buffers[i].range = sizes[i];
 				total_size += mem.size;
 			}
 
-			allocateMemory(total_size, type_bits, scene_info.memories[0U]);
+			allocateMemory(total_size, type_bits, build_state.memories[0U]);
 			for(std::size_t i { 0U }; i < n_buffers; ++i)
 			{
-				device.bindBufferMemory(scene_info.buffers[i].buffer, scene_info.memories[0U],
-					scene_info.buffers[i].offset, dispatch);
+				device.bindBufferMemory(build_state.buffers[i].buffer, build_state.memories[0U],
+					build_state.buffers[i].offset, dispatch);
 			}
 		}
 	}
 	/// <summary>
-	/// Update scene info set. This isn't mutable, and should only be
-	/// used once.
+	/// Update device hierarchy build set. This isn't mutable, and should only
+	/// be used once.
 	/// </summary>
-	void RayTracer::updateSceneInfo()
+	void RayTracer::updateBuildStateSet()
 	{
 		constexpr std::uint32_t n_buffers { 4U };
 
 		std::array<vk::DescriptorBufferInfo, n_buffers> buffers {
-			scene_info.buffers[0U], scene_info.buffers[1U],
-			scene_info.buffers[2U], scene_info.buffers[3U] };
+			build_state.buffers[0U], build_state.buffers[1U],
+			build_state.buffers[2U], build_state.buffers[3U] };
 		buffers[0U].offset = 0U;
 		buffers[1U].offset = 0U;
 		buffers[2U].offset = 0U;
@@ -801,37 +2217,136 @@ namespace Aura::Core
 		std::array<vk::WriteDescriptorSet, n_buffers> const writes {
 			// - Destination set, binding and array element, count.
 			// - Type and info(Image, Buffer, Texel).
-			vk::WriteDescriptorSet{scene_info.set, 0U, 0U, 1U,
+			vk::WriteDescriptorSet{build_state.set, 0U, 0U, 1U,
 				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[0U], nullptr},
-			vk::WriteDescriptorSet{scene_info.set, 1U, 0U, 1U,
+			vk::WriteDescriptorSet{build_state.set, 1U, 0U, 1U,
 				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[1U], nullptr},
-			vk::WriteDescriptorSet{scene_info.set, 2U, 0U, 1U,
+			vk::WriteDescriptorSet{build_state.set, 2U, 0U, 1U,
 				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[2U], nullptr},
-			vk::WriteDescriptorSet{scene_info.set, 3U, 0U, 1U,
+			vk::WriteDescriptorSet{build_state.set, 3U, 0U, 1U,
 				vk::DescriptorType::eStorageBuffer, nullptr, &buffers[3U], nullptr}
 		};
 		device.updateDescriptorSets(n_buffers, writes.data(), 0U, nullptr, dispatch);
 	}
 	/// <summary>
-	/// Destroys the scene info layout, buffers and memory.
+	/// Destroys the device hierarchy build layout, buffers and memory.
 	/// </summary>
-	void RayTracer::tearDownSceneInfo()
+	void RayTracer::tearDownBuildState()
 	{
 		constexpr std::uint32_t n_buffers { 4U };
 
 		for(std::size_t i { 0U }; i < n_buffers; ++i)
 		{
-			destroyBuffer(scene_info.buffers[i].buffer);
+			destroyBuffer(build_state.buffers[i].buffer);
 			if constexpr(DebugSettings::split_memory)
 			{
-				freeMemory(scene_info.memories[i]);
+				freeMemory(build_state.memories[i]);
 			}
 		}
 		if constexpr(!DebugSettings::split_memory)
 		{
-			freeMemory(scene_info.memories[0U]);
+			freeMemory(build_state.memories[0U]);
+		}
+		destroyDescriptorSetLayout(build_state.set_layout);
+	}
+	/// <summary>
+	/// Prepares the intersection timestamps pool, and the buffer and memory of
+	/// the rays queued for each intersection.
+	/// </summary>
+	void RayTracer::setUpIntersectQueries()
+	{
+		if constexpr(DebugSettings::intersect_time)
+		{
+			vk::PhysicalDeviceProperties properties {};
+			physical_device.getProperties(&properties, dispatch);
+			timestamp_period = properties.limits.timestampPeriod;
+			createQueryPool({}, vk::QueryType::eTimestamp, max_intersect_queries, intersect_queries);
+
+			// A count per timestamp pair.
+			vk::DeviceSize const counts_size { static_cast<vk::DeviceSize>(
+				sizeof(std::uint32_t) * max_intersect_queries / 2U) };
+			vk::Buffer buffer {};
+			createBuffer({}, counts_size, vk::BufferUsageFlagBits::eTransferDst, 1U, &compute_family, buffer);
+			vk::MemoryRequirements mem {};
+			device.getBufferMemoryRequirements(buffer, &mem, dispatch);
+
+			intersect_counts.buffers.resize(1U);
+			intersect_counts.buffers[0U].buffer = buffer;
+			intersect_counts.buffers[0U].range = counts_size;
+			intersect_counts.buffers[0U].offset = 0U;
+
+			vk::MemoryPropertyFlags const required {
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+			std::uint32_t type_index { 0U };
+			if(!findMemoryType(mem.memoryTypeBits, required, type_index))
+			{
+				throw std::exception("No memory with required properties. [Intersect counts]");
+			}
+
+			intersect_counts.memories.resize(1U);
+			allocateMemory(mem.size, type_index, intersect_counts.memories[0U]);
+			device.bindBufferMemory(intersect_counts.buffers[0U].buffer, intersect_counts.memories[0U],
+				intersect_counts.buffers[0U].offset, dispatch);
+		}
+	}
+	/// <summary>
+	/// Destroys the intersection timestamps pool, and the queued rays buffer
+	/// and memory.
+	/// </summary>
+	void RayTracer::tearDownIntersectQueries()
+	{
+		if constexpr(DebugSettings::intersect_time)
+		{
+			destroyQueryPool(intersect_queries);
+			destroyBuffer(intersect_counts.buffers[0U].buffer);
+			freeMemory(intersect_counts.memories[0U]);
+		}
+	}
+	/// <summary>
+	/// Prepares the active ray counts buffer and memory.
+	/// </summary>
+	void RayTracer::setUpActiveCounts()
+	{
+		if constexpr(DebugSettings::active_rays)
+		{
+			vk::DeviceSize const counts_size { static_cast<vk::DeviceSize>(sizeof(std::uint32_t) * max_active_counts) };
+			vk::Buffer buffer {};
+			createBuffer({}, counts_size, vk::BufferUsageFlagBits::eTransferDst, 1U, &compute_family, buffer);
+			vk::MemoryRequirements mem {};
+			device.getBufferMemoryRequirements(buffer, &mem, dispatch);
+
+			active_counts.buffers.resize(1U);
+			active_counts.buffers[0U].buffer = buffer;
+			active_counts.buffers[0U].range = counts_size;
+			active_counts.buffers[0U].offset = 0U;
+
+			vk::MemoryPropertyFlags const required {
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent };
+			std::uint32_t type_index { 0U };
+			if(!findMemoryType(mem.memoryTypeBits, required, type_index))
+			{
+				throw std::exception("No memory with required properties. [Active counts]");
+			}
+
+			active_counts.memories.resize(1U);
+			allocateMemory(mem.size, type_index, active_counts.memories[0U]);
+			device.bindBufferMemory(active_counts.buffers[0U].buffer, active_counts.memories[0U],
+				active_counts.buffers[0U].offset, dispatch);
+			// Nothing is counted before the first frame.
+			std::vector<std::uint32_t> zeros(max_active_counts, 0U);
+			updateMem(active_counts.buffers[0U], active_counts.memories[0U], counts_size, zeros.data());
+		}
+	}
+	/// <summary>
+	/// Destroys the active ray counts buffer and memory.
+	/// </summary>
+	void RayTracer::tearDownActiveCounts()
+	{
+		if constexpr(DebugSettings::active_rays)
+		{
+			destroyBuffer(active_counts.buffers[0U].buffer);
+			freeMemory(active_counts.memories[0U]);
 		}
-		destroyDescriptorSetLayout(scene_info.set_layout);
 	}
 
 	// ------------------------------------------------------------------ //
@@ -842,14 +2357,21 @@ namespace Aura::Core
 	/// </summary>
 	void RayTracer::setUpPipelines(ThreadPool & thread_pool)
 	{
-		constexpr std::size_t n_jobs { 6U };
+		constexpr std::size_t n_jobs { 13U };
 
 		std::array<std::future<void>, n_jobs> const jobs {
 			thread_pool.enqueue([&] { setUpPreProcessPipeline(); }),
+			thread_pool.enqueue([&] { setUpAdaptiveMaskPipeline(); }),
 			thread_pool.enqueue([&] { setUpVertexPipeline(); }),
+			thread_pool.enqueue([&] { setUpHierarchyBuildPipelines(); }),
 			thread_pool.enqueue([&] { setUpGenPipeline(); }),
 			thread_pool.enqueue([&] { setUpIntersectPipeline(); }),
+			thread_pool.enqueue([&] { setUpOcclusionPipeline(); }),
+			thread_pool.enqueue([&] { setUpRaySortPipelines(); }),
+			thread_pool.enqueue([&] { setUpMaterialSortPipelines(); }),
 			thread_pool.enqueue([&] { setUpColourScatterPipeline(); }),
+			thread_pool.enqueue([&] { setUpBouncePipeline(); }),
+			thread_pool.enqueue([&] { setUpMegakernelPipeline(); }),
 			thread_pool.enqueue([&] { setUpPostProcessPipeline(); })
 		};
 
@@ -865,10 +2387,17 @@ namespace Aura::Core
 	void RayTracer::tearDownPipelines()
 	{
 		tearDownPostProcessPipeline();
+		tearDownMegakernelPipeline();
+		tearDownBouncePipeline();
 		tearDownColourScatterPipeline();
+		tearDownMaterialSortPipelines();
+		tearDownRaySortPipelines();
+		tearDownOcclusionPipeline();
 		tearDownIntersectPipeline();
 		tearDownGenPipeline();
+		tearDownHierarchyBuildPipelines();
 		tearDownVertexPipeline();
+		tearDownAdaptiveMaskPipeline();
 		tearDownPreProcessPipeline();
 	}
 	/// <summary>
@@ -904,6 +2433,38 @@ namespace Aura::Core
 		destroyPipeline(pre_process.pipeline);
 	}
 	/// <summary>
+	/// Prepares the adaptive sampling mask layout, shader module and pipeline.
+	/// </summary>
+	void RayTracer::setUpAdaptiveMaskPipeline()
+	{
+		constexpr std::uint32_t n_sets { 2U };
+		vk::PipelineCache cache {};
+		vk::ShaderModule shader {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, rays_state.set_layout };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 0U, nullptr, adaptive_mask.layout);
+
+		auto path = std::string(shader_folder);
+		path += "adaptive-mask.spv";
+		createShaderModule({}, path.c_str(), shader);
+
+		vk::PipelineShaderStageCreateInfo const stage { {},
+			vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+		vk::ComputePipelineCreateInfo const create_info { {}, stage,
+			adaptive_mask.layout, vk::Pipeline(), 0U };
+		createComputePipelines(cache, 1U, &create_info, &adaptive_mask.pipeline);
+		destroyShaderModule(shader);
+	}
+	/// <summary>
+	/// Destroys the adaptive sampling mask pipeline, layout 
+	/// </summary>
+	void RayTracer::tearDownAdaptiveMaskPipeline()
+	{
+		destroyPipelineLayout(adaptive_mask.layout);
+		destroyPipeline(adaptive_mask.pipeline);
+	}
+	/// <summary>
 	/// Prepares the vertex layout, shader module and pipeline.
 	/// </summary>
 	void RayTracer::setUpVertexPipeline()
@@ -913,7 +2474,7 @@ namespace Aura::Core
 		vk::ShaderModule shader {};
 
 		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
-			render_settings.set_layout, scene_info.set_layout };
+			render_settings.set_layout, scene_info[0U].set_layout };
 		createPipelineLayout({}, n_sets, set_layouts.data(), 0U, nullptr, vertex.layout);
 
 		auto path = std::string(shader_folder);
@@ -936,6 +2497,53 @@ namespace Aura::Core
 		destroyPipeline(vertex.pipeline);
 	}
 	/// <summary>
+	/// Prepares the device hierarchy build layouts, shader modules and
+	/// pipelines. All passes share the same set layouts.
+	/// </summary>
+	void RayTracer::setUpHierarchyBuildPipelines()
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 4U };
+		vk::PipelineCache cache {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, scene_info[0U].set_layout, build_state.set_layout };
+		std::array<Pipeline *, n_passes> const passes { &morton, &sort, &build, &refit };
+		std::array<char const *, n_passes> const names {
+			"hierarchy-morton.spv", "hierarchy-sort.spv", "hierarchy-build.spv", "hierarchy-refit.spv" };
+
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			vk::ShaderModule shader {};
+			createPipelineLayout({}, n_sets, set_layouts.data(), 0U, nullptr, passes[i]->layout);
+
+			auto path = std::string(shader_folder);
+			path += names[i];
+			createShaderModule({}, path.c_str(), shader);
+
+			vk::PipelineShaderStageCreateInfo const stage { {},
+				vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+			vk::ComputePipelineCreateInfo const create_info { {}, stage,
+				passes[i]->layout, vk::Pipeline(), 0U };
+			createComputePipelines(cache, 1U, &create_info, &passes[i]->pipeline);
+			destroyShaderModule(shader);
+		}
+	}
+	/// <summary>
+	/// Destroys the device hierarchy build pipelines and layouts.
+	/// </summary>
+	void RayTracer::tearDownHierarchyBuildPipelines()
+	{
+		destroyPipelineLayout(refit.layout);
+		destroyPipeline(refit.pipeline);
+		destroyPipelineLayout(build.layout);
+		destroyPipeline(build.pipeline);
+		destroyPipelineLayout(sort.layout);
+		destroyPipeline(sort.pipeline);
+		destroyPipelineLayout(morton.layout);
+		destroyPipeline(morton.pipeline);
+	}
+	/// <summary>
 	/// Prepares the ray generation layout and shader module.
 	/// </summary>
 	void RayTracer::setUpGenPipeline()
@@ -946,8 +2554,9 @@ namespace Aura::Core
 
 		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
 			render_settings.set_layout, ray_launcher.set_layout, rays_state.set_layout };
+		// Sample seed and the tile origin.
 		vk::PushConstantRange const push {
-			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(RandomSeed) };
+			vk::ShaderStageFlagBits::eCompute, 0U, tile_push_offset + sizeof(glm::uvec2) };
 		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, gen.layout);
 
 		auto path = std::string(shader_folder);
@@ -979,8 +2588,11 @@ namespace Aura::Core
 		vk::ShaderModule shader {};
 
 		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
-			render_settings.set_layout, rays_state.set_layout, scene_info.set_layout };
-		createPipelineLayout({}, n_sets, set_layouts.data(), 0U, nullptr, intersect.layout);
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Queue to read the rays from and whenever to read them sorted.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, 2U * sizeof(std::uint32_t) };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, intersect.layout);
 
 		auto path = std::string(shader_folder);
 		path += "intersect.spv";
@@ -1002,6 +2614,137 @@ namespace Aura::Core
 		destroyPipeline(intersect.pipeline);
 	}
 	/// <summary>
+	/// Prepares the occlusion layout, shader module and pipeline.
+	/// </summary>
+	void RayTracer::setUpOcclusionPipeline()
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineCache cache {};
+		vk::ShaderModule shader {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Whenever to trace the shadow rays instead of the rays, and the queue
+		// of the rays that left them.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, 2U * sizeof(std::uint32_t) };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, occlusion.layout);
+
+		auto path = std::string(shader_folder);
+		path += "occlusion.spv";
+		createShaderModule({}, path.c_str(), shader);
+
+		vk::PipelineShaderStageCreateInfo const stage { {},
+			vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+		vk::ComputePipelineCreateInfo const create_info { {}, stage,
+			occlusion.layout, vk::Pipeline(), 0U };
+		createComputePipelines(cache, 1U, &create_info, &occlusion.pipeline);
+		destroyShaderModule(shader);
+	}
+	/// <summary>
+	/// Destroys the occlusion pipeline, layout 
+	/// </summary>
+	void RayTracer::tearDownOcclusionPipeline()
+	{
+		destroyPipelineLayout(occlusion.layout);
+		destroyPipeline(occlusion.pipeline);
+	}
+	/// <summary>
+	/// Prepares the ray sort bounds, count, prefix sum and scatter layouts,
+	/// shader modules and pipelines.
+	/// </summary>
+	void RayTracer::setUpRaySortPipelines()
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 4U };
+		vk::PipelineCache cache {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Queue to sort the rays of.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(std::uint32_t) };
+		std::array<Pipeline *, n_passes> const passes { &ray_bounds, &ray_count, &ray_prefix, &ray_scatter };
+		std::array<char const *, n_passes> const names {
+			"ray-bounds.spv", "ray-count.spv", "ray-prefix.spv", "ray-scatter.spv" };
+
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			vk::ShaderModule shader {};
+			createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, passes[i]->layout);
+
+			auto path = std::string(shader_folder);
+			path += names[i];
+			createShaderModule({}, path.c_str(), shader);
+
+			vk::PipelineShaderStageCreateInfo const stage { {},
+				vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+			vk::ComputePipelineCreateInfo const create_info { {}, stage,
+				passes[i]->layout, vk::Pipeline(), 0U };
+			createComputePipelines(cache, 1U, &create_info, &passes[i]->pipeline);
+			destroyShaderModule(shader);
+		}
+	}
+	/// <summary>
+	/// Destroys the ray sort pipelines and layouts.
+	/// </summary>
+	void RayTracer::tearDownRaySortPipelines()
+	{
+		destroyPipelineLayout(ray_scatter.layout);
+		destroyPipeline(ray_scatter.pipeline);
+		destroyPipelineLayout(ray_prefix.layout);
+		destroyPipeline(ray_prefix.pipeline);
+		destroyPipelineLayout(ray_count.layout);
+		destroyPipeline(ray_count.pipeline);
+		destroyPipelineLayout(ray_bounds.layout);
+		destroyPipeline(ray_bounds.pipeline);
+	}
+	/// <summary>
+	/// Prepares the material sort count and scatter layouts, shader modules
+	/// and pipelines.
+	/// </summary>
+	void RayTracer::setUpMaterialSortPipelines()
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		constexpr std::size_t n_passes { 2U };
+		vk::PipelineCache cache {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Queue to read the rays from.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(std::uint32_t) };
+		std::array<Pipeline *, n_passes> const passes { &material_count, &material_scatter };
+		std::array<char const *, n_passes> const names { "material-count.spv", "material-scatter.spv" };
+
+		for(std::size_t i { 0U }; i < n_passes; ++i)
+		{
+			vk::ShaderModule shader {};
+			createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, passes[i]->layout);
+
+			auto path = std::string(shader_folder);
+			path += names[i];
+			createShaderModule({}, path.c_str(), shader);
+
+			vk::PipelineShaderStageCreateInfo const stage { {},
+				vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+			vk::ComputePipelineCreateInfo const create_info { {}, stage,
+				passes[i]->layout, vk::Pipeline(), 0U };
+			createComputePipelines(cache, 1U, &create_info, &passes[i]->pipeline);
+			destroyShaderModule(shader);
+		}
+	}
+	/// <summary>
+	/// Destroys the material sort pipelines and layouts.
+	/// </summary>
+	void RayTracer::tearDownMaterialSortPipelines()
+	{
+		destroyPipelineLayout(material_scatter.layout);
+		destroyPipeline(material_scatter.pipeline);
+		destroyPipelineLayout(material_count.layout);
+		destroyPipeline(material_count.pipeline);
+	}
+	/// <summary>
 	/// Prepares the scatter layout, shader module and pipeline.
 	/// </summary>
 	void RayTracer::setUpColourScatterPipeline()
@@ -1011,9 +2754,11 @@ namespace Aura::Core
 		vk::ShaderModule shader {};
 
 		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
-			render_settings.set_layout, rays_state.set_layout, scene_info.set_layout };
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Sample seed followed by the queue to read the rays from, whenever to
+		// read them sorted and the bounce.
 		vk::PushConstantRange const push {
-			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(RandomPointInCircleAndSeed) };
+			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(SampleSeed) + 3U * sizeof(std::uint32_t) };
 		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, colour_and_scatter.layout);
 
 		auto path = std::string(shader_folder);
@@ -1036,6 +2781,90 @@ namespace Aura::Core
 		destroyPipeline(colour_and_scatter.pipeline);
 	}
 	/// <summary>
+	/// Prepares the fused intersect and scatter layout, shader module and
+	/// pipeline.
+	/// </summary>
+	void RayTracer::setUpBouncePipeline()
+	{
+		constexpr std::uint32_t n_sets { 3U };
+		vk::PipelineCache cache {};
+		vk::ShaderModule shader {};
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Same push constants as the scatter operation.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(SampleSeed) + 3U * sizeof(std::uint32_t) };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, fused_bounce.layout);
+
+		auto path = std::string(shader_folder);
+		path += "bounce.spv";
+		createShaderModule({}, path.c_str(), shader);
+
+		vk::PipelineShaderStageCreateInfo const stage { {},
+			vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+		vk::ComputePipelineCreateInfo const create_info { {}, stage,
+			fused_bounce.layout, vk::Pipeline(), 0U };
+		createComputePipelines(cache, 1U, &create_info, &fused_bounce.pipeline);
+		destroyShaderModule(shader);
+	}
+	/// <summary>
+	/// Destroys the fused intersect and scatter pipeline, layout 
+	/// </summary>
+	void RayTracer::tearDownBouncePipeline()
+	{
+		destroyPipelineLayout(fused_bounce.layout);
+		destroyPipeline(fused_bounce.pipeline);
+	}
+	/// <summary>
+	/// Prepares the megakernel layout, shader module and pipeline.
+	/// </summary>
+	void RayTracer::setUpMegakernelPipeline()
+	{
+		constexpr std::uint32_t n_sets { 4U };
+		vk::PipelineCache cache {};
+		vk::ShaderModule shader {};
+
+		// Pixels are pulled with subgroup ballots, without them in compute
+		// shaders the pipeline is left out and the wavefront backend is used.
+		vk::PhysicalDeviceSubgroupProperties subgroup {};
+		vk::PhysicalDeviceProperties2 properties {};
+		properties.pNext = &subgroup;
+		physical_device.getProperties2(&properties, dispatch);
+		vk::SubgroupFeatureFlags const operations {
+			vk::SubgroupFeatureFlagBits::eBasic | vk::SubgroupFeatureFlagBits::eBallot };
+		megakernel_supported = (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+			(subgroup.supportedOperations & operations) == operations;
+		if(!megakernel_supported) { return; }
+
+		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
+			render_settings.set_layout, ray_launcher.set_layout, rays_state.set_layout, scene_info[0U].set_layout };
+		// Sample seed and the tile origin.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, tile_push_offset + sizeof(glm::uvec2) };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, megakernel.layout);
+
+		auto path = std::string(shader_folder);
+		path += "megakernel.spv";
+		createShaderModule({}, path.c_str(), shader);
+
+		vk::PipelineShaderStageCreateInfo const stage { {},
+			vk::ShaderStageFlagBits::eCompute, shader, "main", nullptr };
+		vk::ComputePipelineCreateInfo const create_info { {}, stage,
+			megakernel.layout, vk::Pipeline(), 0U };
+		createComputePipelines(cache, 1U, &create_info, &megakernel.pipeline);
+		destroyShaderModule(shader);
+	}
+	/// <summary>
+	/// Destroys the megakernel pipeline, layout 
+	/// </summary>
+	void RayTracer::tearDownMegakernelPipeline()
+	{
+		if(!megakernel_supported) { return; }
+		destroyPipelineLayout(megakernel.layout);
+		destroyPipeline(megakernel.pipeline);
+	}
+	/// <summary>
 	/// Prepares the post-processing layout, shader module and pipeline.
 	/// </summary>
 	void RayTracer::setUpPostProcessPipeline()
@@ -1046,7 +2875,10 @@ namespace Aura::Core
 
 		std::array<vk::DescriptorSetLayout, n_sets> const set_layouts {
 			render_settings.set_layout, rays_state.set_layout, chain_image.set_layout };
-		createPipelineLayout({}, n_sets, set_layouts.data(), 0U, nullptr, post_process.layout);
+		// Tile origin.
+		vk::PushConstantRange const push {
+			vk::ShaderStageFlagBits::eCompute, 0U, sizeof(glm::uvec2) };
+		createPipelineLayout({}, n_sets, set_layouts.data(), 1U, &push, post_process.layout);
 
 		auto path = std::string(shader_folder);
 		path += "post-process.spv";
@@ -9,11 +9,17 @@
 // Internal includes.
 #include <Aura/Core/settings.hpp>
 #include <Aura/Core/Environment/structures.hpp>
+#include <Aura/Core/Environment/hierarchy.hpp>
+#include <Aura/Core/Environment/hierarchy-cache.hpp>
+#include <Aura/Core/Environment/streams.hpp>
+#include <Aura/Core/Environment/lights.hpp>
 #include <Aura/Core/Render/structures.hpp>
 #include "swapchain.hpp"
 // Standard includes.
+#include <array>
 #include <cstdint>
 #include <shared_mutex>
+#include <string>
 #include <vector>
 // External includes.
 #pragma warning(disable : 26495)
@@ -65,11 +71,49 @@ namespace Aura::Core
 	{
 		// Work group sizes.
 		static constexpr std::uint32_t pre_gsize[3U] = { 8U, 8U, 1U };
+		static constexpr std::uint32_t adaptive_gsize[3U] = { 8U, 8U, 1U };
 		static constexpr std::uint32_t vertex_gsize[3U] = { 8U, 1U, 1U };
+		static constexpr std::uint32_t build_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t refit_gsize[3U] = { 64U, 1U, 1U };
 		static constexpr std::uint32_t gen_gsize[3U] = { 8U, 8U, 1U };
-		static constexpr std::uint32_t intersect_gsize[3U] = { 8U, 8U, 1U };
-		static constexpr std::uint32_t colour_and_scatter_gsize[3U] = { 8U, 8U, 1U };
+		// Queued stages, must match the shaders queue group size.
+		static constexpr std::uint32_t intersect_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t material_sort_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t ray_sort_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t occlusion_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t colour_and_scatter_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t bounce_gsize[3U] = { 64U, 1U, 1U };
+		static constexpr std::uint32_t megakernel_gsize[3U] = { 64U, 1U, 1U };
 		static constexpr std::uint32_t post_gsize[3U] = { 8U, 8U, 1U };
+		// Intersection timestamps, a pair per recorded intersection.
+		static constexpr std::uint32_t max_intersect_queries { 4096U };
+		// Active ray counts, one per recorded bounce.
+		static constexpr std::uint32_t max_active_counts { 4096U };
+		// Scene info copies, uploads take turns on them so an upload never
+		// writes the copy the previous frame may still read.
+		static constexpr std::uint32_t scene_copies { 2U };
+		// Scene info staging slots, uploads take turns on them so an upload
+		// is never staged over the two the transfer queue may still copy, its
+		// own and the one it replays.
+		static constexpr std::uint32_t staging_slots { 3U };
+		// Ray queues, rays of a bounce are read from one and the rays left
+		// alive are appended to the other.
+		static constexpr std::uint32_t n_ray_queues { 2U };
+		// Work groups along x of the queued dispatches, the least every device
+		// supports. Longer queues are dispatched in rows of groups, must match
+		// the queued shaders.
+		static constexpr std::uint32_t queue_row { 65535U };
+		// Material sort buckets, must match the sort shaders.
+		static constexpr std::uint32_t n_material_buckets { 8U };
+		// Ray sort buckets, a direction octant and an origin quantized to 3
+		// bits per axis each. Must match the sort shaders.
+		static constexpr std::uint32_t n_ray_buckets { 8U << 9U };
+		// Megakernel persistent work groups, enough to fill the device. Pixels
+		// are pulled from a counter, so the image size does not matter.
+		static constexpr std::uint32_t megakernel_groups { 1024U };
+		// Ray-generation and megakernel tile origin push offset, past the
+		// sample seed at the shader's uvec2 alignment.
+		static constexpr std::uint32_t tile_push_offset { 16U };
 		// Shader folder location
 		static constexpr char const * shader_folder = "../aura/core/shaders/";
 		// Scene access shared guard.
@@ -80,6 +124,14 @@ namespace Aura::Core
 		std::uint32_t const width;
 		// Image height in pixels.
 		std::uint32_t const height;
+		// Samples traced together as one wavefront. Rays, hits, pixels and
+		// queues hold a slice per sample.
+		std::uint32_t const batch;
+		// Traced tile width in pixels, the image width if not tiled. Rays
+		// state is sized by the tile.
+		std::uint32_t const tile_width;
+		// Traced tile height in pixels, the image height if not tiled.
+		std::uint32_t const tile_height;
 		// Compute family index.
 		std::uint32_t const compute_family;
 		// Transfer family index.
@@ -92,22 +144,122 @@ namespace Aura::Core
 		Resource ray_launcher;
 		// Rays, Hits and Pixels.
 		Resource rays_state;
-		// Scene information.
-		Resource scene_info;
+		// Scene information, in device local memory. Copies share the layout
+		// of the first.
+		std::array<Resource, scene_copies> scene_info;
+		// Scene info copy bound by the recorded frames, the last uploaded.
+		std::uint32_t scene_copy { 0U };
+		// Scene info staging ring, host memory the scene updates are written
+		// to before the transfer queue copies them to the device.
+		Resource staging;
+		// Staging memory, mapped for as long as it lives.
+		void * staging_data { nullptr };
+		// Bytes per staging slot, enough for every scene info buffer at once.
+		vk::DeviceSize staging_slot_size { 0U };
+		// Staging slot of the next upload, and the next free byte within it.
+		std::uint32_t staging_slot { 0U };
+		vk::DeviceSize staging_head { 0U };
+		// Copies staged for the next upload, per scene info buffer.
+		std::vector<std::vector<vk::BufferCopy>> staged_copies;
+		// Copies of the last upload, per scene info buffer. The next upload
+		// replays them to the other copy, which missed them.
+		std::vector<std::vector<vk::BufferCopy>> replayed_copies;
+		// Scene info buffers written by the last recorded upload.
+		std::vector<std::size_t> uploaded_buffers;
+		// Device built hierarchy nodes and references, copied back to host
+		// memory for their validation.
+		Resource scene_readback;
+		// Device hierarchy build scratch.
+		Resource build_state;
+		// Intersection stage timestamps.
+		vk::QueryPool intersect_queries;
+		// Rays queued for each timed intersection, read back by the host.
+		Resource intersect_counts;
+		// Rays left alive after each bounce, read back by the host.
+		Resource active_counts;
+		// Accumulated pixels, read back by the host on request.
+		Resource pixel_readback;
+		// Nanoseconds per timestamp tick.
+		float timestamp_period { 1.0f };
+		// Timestamps reset for the frame being recorded.
+		mutable std::uint32_t n_intersect_queries { 0U };
+		// Bounces per sample of the frame being recorded, tells primary and
+		// secondary intersections apart.
+		mutable std::uint32_t n_intersect_bounces { 1U };
 		// Pre processing pipeline.
 		Pipeline pre_process;
+		// Adaptive sampling mask pipeline.
+		Pipeline adaptive_mask;
 		// Absorption and colouring pipeline.
 		Pipeline vertex;
+		// Device hierarchy Morton codes pipeline.
+		Pipeline morton;
+		// Device hierarchy sort pipeline.
+		Pipeline sort;
+		// Device hierarchy linear build pipeline.
+		Pipeline build;
+		// Device hierarchy refit pipeline.
+		Pipeline refit;
 		// Ray Generation pipeline.
 		Pipeline gen;
 		// Intersection pipeline.
 		Pipeline intersect;
+		// Any hit occlusion pipeline.
+		Pipeline occlusion;
+		// Ray sort origins bounds pipeline.
+		Pipeline ray_bounds;
+		// Ray sort bucket count pipeline.
+		Pipeline ray_count;
+		// Ray sort bucket prefix sum pipeline.
+		Pipeline ray_prefix;
+		// Ray sort scatter pipeline.
+		Pipeline ray_scatter;
+		// Material sort bucket count pipeline.
+		Pipeline material_count;
+		// Material sort scatter pipeline.
+		Pipeline material_scatter;
 		// Scattering pipeline.
 		Pipeline colour_and_scatter;
+		// Fused intersect and scatter pipeline.
+		Pipeline fused_bounce;
+		// Megakernel pipeline.
+		Pipeline megakernel;
+		// Whenever the device has the compute subgroup ballots the megakernel
+		// needs, otherwise its pipeline is not created.
+		bool megakernel_supported { false };
 		// Post processing pipeline.
 		Pipeline post_process;
 		// Image height in pixels.
 		std::uint32_t n_primitives;
+		// Scene bounding volume hierarchy, rebuilt on geometry changes.
+		Hierarchy hierarchy;
+		// Scene two level hierarchy, top level rebuilt on transform changes.
+		TwoLevelHierarchy two_level;
+		// Scene hierarchy collapsed into wide nodes, for the wide traversal.
+		WideHierarchy wide;
+		// On-disk cache of the two level bottom levels.
+		HierarchyCache cache;
+		// Scene primitives split by type, hierarchy references point into them.
+		PrimitiveStreams streams;
+		// Scene emissive surfaces, sampled by next event estimation.
+		LightList lights;
+		// Whenever the lights must be rebuilt, as the materials changed.
+		bool lights_outdated { true };
+		// Traversal the scene info was last uploaded for.
+		TraversalModes scene_traversal { TraversalModes::Hierarchy };
+		// Builder the scene hierarchy was last built with.
+		HierarchyBuilders scene_builder { HierarchyBuilders::Host };
+		// Whenever the camera and the scene were uploaded at all. A framework
+		// created again, with a scene already in place, uploads it anew.
+		bool launcher_uploaded { false };
+		bool scene_uploaded { false };
+		// Render settings last uploaded, and whenever they were at all.
+		RenderSettings uploaded_settings {};
+		bool settings_uploaded { false };
+		// Boxes of the last device build, kept for its validation.
+		std::vector<Bounds> validation_bounds;
+		// Whenever the last device build still needs validation.
+		bool validation_pending { false };
 
 		// ------------------------------------------------------------------ //
 		// Set-up and tear-down.
@@ -123,7 +275,8 @@ namespace Aura::Core
 			vk::SurfaceKHR const & surface, vk::Extent2D const & chain_base_extent,
 			std::uint32_t const compute_family, std::uint32_t const transfer_family,
 			std::uint32_t const present_family, ThreadPool & thread_pool,
-			std::uint32_t const width, std::uint32_t const height,
+			std::uint32_t const width, std::uint32_t const height, std::uint32_t const batch,
+			std::uint32_t const tile_width, std::uint32_t const tile_height,
 			std::shared_mutex & scene_guard, Scene * const & scene);
 		/// <summary>
 		/// Stops rendering and tears-down the core.
@@ -142,49 +295,262 @@ namespace Aura::Core
 		/// </summary>
 		void recordVertex(vk::CommandBuffer const & command) const;
 		/// <summary>
-		/// Records a ray-generation operation.
+		/// Records a device hierarchy build over the transformed primitives.
+		/// Morton codes, sort, linear build and refit run as separate passes.
+		/// With hierarchy validation, the result is copied back to host memory.
 		/// </summary>
-		void recordRayGen(RandomSeed & push, vk::CommandBuffer const & command) const;
+		void recordHierarchyBuild(vk::CommandBuffer const & command) const;
 		/// <summary>
-		/// Records a intersect operation.
+		/// Records an adaptive sampling mask operation, marking the pixels of
+		/// the tile which still take samples. Ray-generation and the
+		/// megakernel skip the others, the mask is made visible to them.
 		/// </summary>
-		void recordIntersect(vk::CommandBuffer const & command) const;
+		void recordAdaptiveMask(vk::CommandBuffer const & command) const;
 		/// <summary>
-		/// Records a scatter operation.
+		/// Records a ray-generation operation for every sample of the batch,
+		/// over the tile at the given image origin. Generated rays are
+		/// appended to the first bounce queue.
 		/// </summary>
-		void recordColourAndScatter(RandomPointInCircleAndSeed & push, vk::CommandBuffer const & command) const;
+		void recordRayGen(SampleSeed const & push, vk::CommandBuffer const & command,
+			glm::uvec2 const tile) const;
 		/// <summary>
-		/// Records a post-processing operation.
+		/// Records a sort of the rays queued for the given bounce by their
+		/// direction octant and quantized origin. Must be recorded before the
+		/// intersect operation of the bounce, which then reads the sorted rays.
 		/// </summary>
-		void recordPostProcess(vk::CommandBuffer const & command) const;
+		void recordRaySort(vk::CommandBuffer const & command, std::uint32_t const bounce) const;
+		/// <summary>
+		/// Records a intersect operation over the rays queued for the given
+		/// bounce, dispatched indirectly from the queue size. Rays are read in
+		/// their sorted order if requested. The index tells the intersection
+		/// apart within the frame, for its timestamps.
+		/// </summary>
+		void recordIntersect(vk::CommandBuffer const & command, std::uint32_t const intersect_idx,
+			std::uint32_t const bounce, bool const sorted) const;
+		/// <summary>
+		/// Records an occlusion operation. Rays stop at their first hit and
+		/// only write their occlusion bit, hits are left untouched.
+		/// </summary>
+		void recordOcclusion(vk::CommandBuffer const & command) const;
+		/// <summary>
+		/// Records a shadow operation, with the occlusion pipeline. Shadow
+		/// rays left by the scatter of the given bounce stop at their first
+		/// hit before their light point, and the unblocked ones add their
+		/// light to the path sample of their ray. Paths that ended on that
+		/// scatter add their sample then. The dispatch follows the queue of
+		/// the bounce.
+		/// </summary>
+		void recordShadows(vk::CommandBuffer const & command, std::uint32_t const bounce) const;
+		/// <summary>
+		/// Records the reset of the intersection timestamps of a frame with
+		/// the given number of samples and bounces.
+		/// </summary>
+		void recordIntersectQueriesReset(std::uint32_t const n_samples, std::uint32_t const n_bounces,
+			vk::CommandBuffer const & command) const;
+		/// <summary>
+		/// Outputs the queued rays per second of the intersection stage on
+		/// the last frame, for primary and secondary rays. The frame must be
+		/// finished.
+		/// </summary>
+		void outputIntersectTime() const;
+		/// <summary>
+		/// Records a copy of the rays left alive after the given bounce. The
+		/// index tells the bounce apart within the frame.
+		/// </summary>
+		void recordActiveRays(vk::CommandBuffer const & command, std::uint32_t const bounce_idx,
+			std::uint32_t const bounce) const;
+		/// <summary>
+		/// Outputs the rays left alive after each bounce on the last frame,
+		/// averaged over its samples. The frame must be finished.
+		/// </summary>
+		void outputActiveRays(std::uint32_t const n_samples, std::uint32_t const n_bounces) const;
+		/// <summary>
+		/// Prepares the pixels read back buffer and memory.
+		/// </summary>
+		void setUpPixelReadback();
+		/// <summary>
+		/// Records a copy of the accumulated pixels to the read back buffer.
+		/// </summary>
+		void recordPixelReadback(vk::CommandBuffer const & command) const;
+		/// <summary>
+		/// Mean luminance of the pixels read back, over the pixels with any
+		/// sample. Covers the last traced tile, the whole image unless tiled.
+		/// The copy must be finished.
+		/// </summary>
+		float readMeanLuminance() const;
+		/// <summary>
+		/// Destroys the pixels read back buffer and memory.
+		/// </summary>
+		void tearDownPixelReadback();
+		/// <summary>
+		/// Whenever scene info updates are staged, or the last upload is not
+		/// replayed yet, and wait for an upload.
+		/// </summary>
+		bool uploadPending() const noexcept;
+		/// <summary>
+		/// Scene info copy bound by the recorded frames, written by the last
+		/// upload.
+		/// </summary>
+		std::uint32_t sceneCopy() const noexcept
+		{ return scene_copy; }
+		/// <summary>
+		/// Whenever the megakernel backend is available on the device.
+		/// </summary>
+		bool megakernelSupported() const noexcept
+		{ return megakernel_supported; }
+		/// <summary>
+		/// Records the release of the scene info buffers the next upload
+		/// writes to, on the copy the recorded frames do not bind, from the
+		/// compute family to the transfer family. Must be submitted to the
+		/// compute queue before the upload. Records nothing if both queues
+		/// share a family.
+		/// </summary>
+		void recordSceneRelease(vk::CommandBuffer const & command) const;
+		/// <summary>
+		/// Records the copies of the last upload and of the staged scene info
+		/// updates to the copy the recorded frames do not bind, for the
+		/// transfer queue, with the release of the written buffers back to the
+		/// compute family. Later frames bind the written copy, and later
+		/// updates are staged in the next slot. The frames that read the
+		/// written copy must be finished.
+		/// </summary>
+		void recordSceneUpload(vk::CommandBuffer const & command);
+		/// <summary>
+		/// Records the compute family acquire of the scene info buffers
+		/// written by the last upload. Must come before the scene info is
+		/// used, in a submission waiting on the upload.
+		/// </summary>
+		void recordSceneAcquire(vk::CommandBuffer const & command) const;
+		/// <summary>
+		/// Records a counting sort of the rays queued for the given bounce by
+		/// the type of their hit material. The following scatter operation
+		/// then shades the sorted rays, so work groups run the same material
+		/// path. Must be recorded between the intersect and scatter operations
+		/// of the bounce.
+		/// </summary>
+		void recordMaterialSort(vk::CommandBuffer const & command, std::uint32_t const bounce) const;
+		/// <summary>
+		/// Records a scatter operation over the rays queued for the given
+		/// bounce. Rays are read in their sorted order if requested. Rays left
+		/// alive are queued for the next bounce.
+		/// </summary>
+		void recordColourAndScatter(SampleSeed const & push, vk::CommandBuffer const & command,
+			std::uint32_t const bounce, bool const sorted) const;
+		/// <summary>
+		/// Records a fused intersect and scatter operation over the rays
+		/// queued for the given bounce, with hits kept in registers. Stands
+		/// for both operations of the bounce, rays are read in their sorted
+		/// order if requested and rays left alive are queued for the next.
+		/// </summary>
+		void recordBounce(SampleSeed const & push, vk::CommandBuffer const & command,
+			std::uint32_t const bounce, bool const sorted) const;
+		private:
+		/// <summary>
+		/// Records the reset of the given ray queue to an empty queue.
+		/// </summary>
+		void recordQueueReset(std::uint32_t const queue, vk::CommandBuffer const & command) const;
+		public:
+		/// <summary>
+		/// Records a megakernel operation, which traces every bounce of every
+		/// pixel on its own. Stands for the ray-generation, intersect and
+		/// scatter operations of a sample, over the tile at the given image
+		/// origin.
+		/// </summary>
+		void recordMegakernel(SampleSeed const & push, vk::CommandBuffer const & command,
+			glm::uvec2 const tile) const;
+		/// <summary>
+		/// Records a post-processing operation, writing the tile at the given
+		/// image origin to the chain image.
+		/// </summary>
+		void recordPostProcess(vk::CommandBuffer const & command, glm::uvec2 const tile) const;
 
 		// ------------------------------------------------------------------ //
 		// Resource updates.
 		// ------------------------------------------------------------------ //
 		/// <summary>
-		/// Updates the render settings.
+		/// Updates the render settings, if they changed since the last upload.
+		/// Light counts come from the last scene update, so it must come
+		/// first. Returns whenever they were uploaded.
 		/// </summary>
-		void updateRenderSettings(float const t_min, float const t_max,
-			std::uint32_t const n_samples, std::uint32_t const n_bounces);
+		bool updateRenderSettings(float const t_min, float const t_max,
+			std::uint32_t const n_samples, std::uint32_t const n_bounces,
+			TraversalModes const traversal, std::uint32_t const roulette_depth,
+			float const adaptive_threshold, std::uint32_t const adaptive_min, bool const next_event);
 		/// <summary>
 		/// Updates the ray launcher using the camera in the scene.
 		/// </summary>
 		bool updateRayLauncher();
 		/// <summary>
-		/// Updates scene vertices.
+		/// Traversal drawing the whole scene with the requested one. Only the
+		/// two level traversal draws instances, so scenes with any use it.
+		/// </summary>
+		TraversalModes sceneTraversal(TraversalModes const traversal) const;
+		/// <summary>
+		/// Updates scene vertices, transforms and primitives. Geometry changes
+		/// also rebuild and update the hierarchy used by the given traversal.
+		/// In two level traversal, transform only changes rebuild just the top
+		/// level. With the device builder the hierarchy is left to the device.
+		/// Host hierarchies are refitted on transform only changes, until their
+		/// cost ratio against the last build passes the threshold. Two level
+		/// bottom levels go through the hierarchy cache in the given
+		/// directory, spatial builds use the given extra references budget.
+		/// Lights are rebuilt with any scene or materials change.
+		/// </summary>
+		bool updateScene(TraversalModes const traversal, HierarchyBuilders const builder,
+			float const refit_threshold, float const spatial_budget, std::string const & cache_directory);
+		/// <summary>
+		/// Updates scene materials.
 		/// </summary>
-		bool updateScene();
+		bool updateMaterials();
 		/// <summary>
 		/// Updates the device memory
 		/// </summary>
 		void updateMem(vk::DescriptorBufferInfo & buffer, vk::DeviceMemory & memory,
 			vk::DeviceSize size, void * data);
+		/// <summary>
+		/// Stages an update of a scene info buffer, copied to the device with
+		/// the next upload.
+		/// </summary>
+		void updateSceneMem(std::size_t const idx, vk::DeviceSize size, void * data);
+		private:
+		/// <summary>
+		/// Uploads the primitive streams and the stream reference of each
+		/// primitive.
+		/// </summary>
+		void updateStreamsMem();
+		/// <summary>
+		/// Reads back the hierarchy nodes or references scene info buffer,
+		/// from the copy the last device build left in host memory.
+		/// </summary>
+		void readSceneMem(std::size_t const idx, vk::DeviceSize size, void * data);
+		/// <summary>
+		/// Checks the last device built hierarchy against a host built
+		/// reference over the same boxes and outputs any differences.
+		/// </summary>
+		void validateHierarchy();
+		public:
+		/// <summary>
+		/// Hierarchy builds found in the cache since the framework creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheHits() const noexcept
+		{ return cache.hits; }
+		/// <summary>
+		/// Hierarchy builds not found in the cache since the framework
+		/// creation.
+		/// </summary>
+		std::uint32_t getHierarchyCacheMisses() const noexcept
+		{ return cache.misses; }
 
 		// ------------------------------------------------------------------ //
 		// Resources.
 		// ------------------------------------------------------------------ //
 		private:
 		/// <summary>
+		/// Checks the sample batch against the device limits, before any
+		/// resource is set up. Throws if the rays state would not fit them.
+		/// </summary>
+		void validateBatch() const;
+		/// <summary>
 		/// Sets up the descriptor pool and bulk sets-up all the resources needed.
 		/// </summary>
 		void setUpResources(ThreadPool & thread_pool);
@@ -244,18 +610,67 @@ namespace Aura::Core
 		/// </summary>
 		void tearDownRaysState();
 		/// <summary>
-		/// Prepares scene info layout, buffers and memory.
+		/// Prepares scene info layout, and the buffers and memory of each
+		/// copy.
 		/// </summary>
 		void setUpSceneInfo();
 		/// <summary>
-		/// Update scene info set. This isn't mutable, and should only be
-		/// used once.
+		/// Update scene info sets, each to its copy. This isn't mutable, and
+		/// should only be used once.
 		/// </summary>
 		void updateSceneInfo();
 		/// <summary>
-		/// Destroys the scene info layout, buffers and memory.
+		/// Destroys the scene info layout, and the buffers and memory of each
+		/// copy.
 		/// </summary>
 		void tearDownSceneInfo();
+		/// <summary>
+		/// Prepares the scene info staging ring buffer and its mapped memory.
+		/// </summary>
+		void setUpStaging();
+		/// <summary>
+		/// Destroys the scene info staging ring buffer and memory.
+		/// </summary>
+		void tearDownStaging();
+		/// <summary>
+		/// Prepares the hierarchy validation read back buffer and memory.
+		/// </summary>
+		void setUpSceneReadback();
+		/// <summary>
+		/// Destroys the hierarchy validation read back buffer and memory.
+		/// </summary>
+		void tearDownSceneReadback();
+		/// <summary>
+		/// Prepares the device hierarchy build layout, buffers and memory.
+		/// </summary>
+		void setUpBuildState();
+		/// <summary>
+		/// Update device hierarchy build set. This isn't mutable, and should
+		/// only be used once.
+		/// </summary>
+		void updateBuildStateSet();
+		/// <summary>
+		/// Destroys the device hierarchy build layout, buffers and memory.
+		/// </summary>
+		void tearDownBuildState();
+		/// <summary>
+		/// Prepares the intersection timestamps pool, and the buffer and
+		/// memory of the rays queued for each intersection.
+		/// </summary>
+		void setUpIntersectQueries();
+		/// <summary>
+		/// Destroys the intersection timestamps pool, and the queued rays
+		/// buffer and memory.
+		/// </summary>
+		void tearDownIntersectQueries();
+		/// <summary>
+		/// Prepares the active ray counts buffer and memory.
+		/// </summary>
+		void setUpActiveCounts();
+		/// <summary>
+		/// Destroys the active ray counts buffer and memory.
+		/// </summary>
+		void tearDownActiveCounts();
 
 		// ------------------------------------------------------------------ //
 		// Pipelines.
@@ -277,6 +692,15 @@ namespace Aura::Core
 		/// </summary>
 		void tearDownPreProcessPipeline();
 		/// <summary>
+		/// Prepares the adaptive sampling mask layout, shader module and
+		/// pipeline.
+		/// </summary>
+		void setUpAdaptiveMaskPipeline();
+		/// <summary>
+		/// Destroys the adaptive sampling mask pipeline, layout 
+		/// </summary>
+		void tearDownAdaptiveMaskPipeline();
+		/// <summary>
 		/// Prepares the vertex layout, shader module and pipeline.
 		/// </summary>
 		void setUpVertexPipeline();
@@ -285,6 +709,15 @@ namespace Aura::Core
 		/// </summary>
 		void tearDownVertexPipeline();
 		/// <summary>
+		/// Prepares the device hierarchy build layouts, shader modules and
+		/// pipelines.
+		/// </summary>
+		void setUpHierarchyBuildPipelines();
+		/// <summary>
+		/// Destroys the device hierarchy build pipelines and layouts.
+		/// </summary>
+		void tearDownHierarchyBuildPipelines();
+		/// <summary>
 		/// Prepares the ray generation layout, shader module and pipeline.
 		/// </summary>
 		void setUpGenPipeline();
@@ -301,6 +734,32 @@ namespace Aura::Core
 		/// </summary>
 		void tearDownIntersectPipeline();
 		/// <summary>
+		/// Prepares the occlusion layout, shader module and pipeline.
+		/// </summary>
+		void setUpOcclusionPipeline();
+		/// <summary>
+		/// Destroys the occlusion pipeline, layout 
+		/// </summary>
+		void tearDownOcclusionPipeline();
+		/// <summary>
+		/// Prepares the ray sort bounds, count, prefix sum and scatter layouts,
+		/// shader modules and pipelines.
+		/// </summary>
+		void setUpRaySortPipelines();
+		/// <summary>
+		/// Destroys the ray sort pipelines and layouts.
+		/// </summary>
+		void tearDownRaySortPipelines();
+		/// <summary>
+		/// Prepares the material sort count and scatter layouts, shader modules
+		/// and pipelines.
+		/// </summary>
+		void setUpMaterialSortPipelines();
+		/// <summary>
+		/// Destroys the material sort pipelines and layouts.
+		/// </summary>
+		void tearDownMaterialSortPipelines();
+		/// <summary>
 		/// Prepares the scatter layout, shader module and pipeline.
 		/// </summary>
 		void setUpColourScatterPipeline();
@@ -309,6 +768,23 @@ namespace Aura::Core
 		/// </summary>
 		void tearDownColourScatterPipeline();
 		/// <summary>
+		/// Prepares the fused intersect and scatter layout, shader module and
+		/// pipeline.
+		/// </summary>
+		void setUpBouncePipeline();
+		/// <summary>
+		/// Destroys the fused intersect and scatter pipeline, layout 
+		/// </summary>
+		void tearDownBouncePipeline();
+		/// <summary>
+		/// Prepares the megakernel layout, shader module and pipeline.
+		/// </summary>
+		void setUpMegakernelPipeline();
+		/// <summary>
+		/// Destroys the megakernel pipeline, layout 
+		/// </summary>
+		void tearDownMegakernelPipeline();
+		/// <summary>
 		/// Prepares the post-processing layout, shader module and pipeline.
 		/// </summary>
 		void setUpPostProcessPipeline();
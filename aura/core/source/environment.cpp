@@ -204,6 +204,41 @@ namespace Aura::Core
 		return true;
 	}
 	/// <summary>
+	/// Creates an entity instancing the primitives of the source entity, with
+	/// its own transform and material, and updates given index.
+	/// Returns whenever a new instance was created.
+	/// </summary>
+	bool Environment::newInstance(std::uint32_t const source_idx, std::uint32_t const material_idx,
+		std::uint32_t & idx)
+	{
+		std::uint32_t source { source_idx };
+		{
+			std::shared_lock<std::shared_mutex> scene_lock(guard);
+			std::unique_lock<std::mutex> entity_lock(scene->entities.guard);
+			if(source >= scene->entities.data.size())
+			{
+				return false;
+			}
+			// Instances of instances share the same primitives.
+			if(scene->entities.data[source].source_idx != Entity::no_source)
+			{
+				source = scene->entities.data[source].source_idx;
+			}
+		}
+		std::uint32_t transform_idx { 0U };
+		Transform transform {};
+		if(!addTransform(transform, transform_idx))
+		{
+			return false;
+		}
+		Entity entity { transform_idx, material_idx, {}, source };
+		if(!addEntity(entity, idx))
+		{
+			return false;
+		}
+		return true;
+	}
+	/// <summary>
 	/// Adds a the given primitive to the scene. The primitive's material
 	/// and transform indices are ignored and it is moved into the scene. 
 	/// </summary>
@@ -213,6 +248,11 @@ namespace Aura::Core
 			std::shared_lock<std::shared_mutex> scene_lock(guard);
 			std::unique_lock<std::mutex> entity_lock(scene->entities.guard);
 			Entity & entity = scene->entities.data[entity_idx];
+			// Instances share the primitives of their source.
+			if(entity.source_idx != Entity::no_source)
+			{
+				return false;
+			}
 			primitive.material_idx = entity.material_idx;
 			primitive.transform_idx = entity.transform_idx;
 		}
@@ -228,7 +268,7 @@ namespace Aura::Core
 			Entity & entity = scene->entities.data[entity_idx];
 			{
 				std::unique_lock<std::mutex> primitive_lock(scene->primitives.guard);
-				entity.primitives.emplace_back(p_primitive);
+				entity.primitives.emplace_back(primitive_idx);
 			}
 		}
 		return true;
@@ -246,8 +286,9 @@ namespace Aura::Core
 			std::unique_lock<std::mutex> primitive_lock(scene->primitives.guard);
 			for(std::size_t i { 0U }; i < entity.primitives.size(); ++i)
 			{
-				entity.primitives[i]->material_idx = material_idx;
+				scene->primitives.data[entity.primitives[i]].material_idx = material_idx;
 			}
+			scene->primitives.updated = true;
 		}
 	}
 	/// <summary>
@@ -264,6 +305,7 @@ namespace Aura::Core
 			{
 				std::unique_lock<std::mutex> transform_lock(scene->transforms.guard);
 				scene->transforms.data[entity.transform_idx].translation = translation;
+				scene->transforms.updated = true;
 			}
 		}
 	}
@@ -281,6 +323,7 @@ namespace Aura::Core
 			{
 				std::unique_lock<std::mutex> transform_lock(scene->transforms.guard);
 				scene->transforms.data[entity.transform_idx].scaling = scaling;
+				scene->transforms.updated = true;
 			}
 		}
 	}
@@ -299,6 +342,7 @@ namespace Aura::Core
 			{
 				std::unique_lock<std::mutex> transform_lock(scene->transforms.guard);
 				scene->transforms.data[entity.transform_idx].rotation = rotation;
+				scene->transforms.updated = true;
 			}
 		}
 	}
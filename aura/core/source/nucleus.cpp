@@ -204,12 +204,10 @@ namespace Aura::Core
 	/// </summary>
 	void Nucleus::renderFrame()
 	{
-		if(!render.dispatchFrame())
-		{
-			std::unique_lock<std::mutex> lock { rendering_guard };
-			rendering = false;
-		}
-		if(!render.waitForMainFence(std::numeric_limits<std::uint64_t>::max()))
+		// The frame is left rendering, the next dispatch waits for it once
+		// its own scene updates are uploaded. A failed dispatch either timed
+		// out on the previous frame or acquired no image, the fence tells.
+		if(!render.dispatchFrame() && !render.waitForMainFence(std::numeric_limits<std::uint64_t>::max()))
 		{
 			std::unique_lock<std::mutex> render_lock { rendering_guard };
 			rendering = false;
@@ -225,7 +223,8 @@ namespace Aura::Core
 		frameCounterIncrement();
 	}
 	/// <summary>
-	/// Schedule a rendering job, wait for it to stop and outputs time.
+	/// Schedule a rendering job and outputs its time, which covers the wait
+	/// for the previous frame.
 	/// </summary>
 	void Nucleus::renderWithTime()
 	{
@@ -267,8 +266,12 @@ namespace Aura::Core
 				new_settings.window_mode != display_settings.window_mode ||
 				new_settings.width != display_settings.width ||
 				new_settings.height != display_settings.height;
+			// Rays state is sized by the sample batch and tile on the framework
+			// creation.
 			device_reset =
-				new_settings.device_name != display_settings.device_name;
+				new_settings.device_name != display_settings.device_name ||
+				new_settings.sample_batch != display_settings.sample_batch ||
+				new_settings.tile_size != display_settings.tile_size;
 			sync_reset =
 				new_settings.anti_aliasing != display_settings.anti_aliasing ||
 				new_settings.ray_depth != display_settings.ray_depth;
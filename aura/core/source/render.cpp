@@ -9,6 +9,7 @@
 #include <Aura/Core/nucleus.hpp>
 #include "Render/ray-tracer.hpp"
 // Standard includes.
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -42,7 +43,8 @@ namespace Aura::Core
 	Render::Render(Nucleus & nucleus) :
 		core_nucleus(nucleus),
 		stage_flags({ vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader,
-			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe })
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe }),
+		first_stages({ vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader })
 	{
 		initVulkan();
 		queryPhysicalDevices();
@@ -65,21 +67,48 @@ namespace Aura::Core
 	{
 		std::uint32_t frame_idx { 0U };
 
+		// Hierarchy validation reads the device build of the previous frame
+		// back while staging, so it waits for it first.
+		if constexpr(DebugSettings::validate_hierarchy)
+		{
+			if(!waitForMainFence(std::numeric_limits<std::uint64_t>::max()))
+			{
+				return false;
+			}
+		}
+		// Scene updates are copied on the transfer queue while the previous
+		// frame renders. An upload whose frame was not dispatched is kept.
+		if(!scene_upload.submitted)
+		{
+			updateScene();
+		}
 		// Wait for previous image to render.
-		if(!waitForMainFence(0U))
+		if(!waitForMainFence(std::numeric_limits<std::uint64_t>::max()))
 		{
 			return false;
 		}
-		device.resetFences(1U, &main_fence, dispatch);
+		if constexpr(DebugSettings::intersect_time)
+		{
+			framework->outputIntersectTime();
+		}
+		if constexpr(DebugSettings::active_rays)
+		{
+			framework->outputActiveRays(static_cast<std::uint32_t>(dispatch_jobs.size()) - 2U,
+				core_nucleus.display_settings.ray_depth);
+		}
 		// Try to acquire frame.
 		if(!framework->acquireframe(acquisition_semaphore, nullptr, 0, frame_idx))
 		{
 			return false;
 		}
+		device.resetFences(1U, &main_fence, dispatch);
 		// Enqueue environment update jobs and wait for them to finish.
-		bool update = updateEnvironment(frame_idx);
+		bool const update { updateEnvironment(frame_idx) || scene_upload.update };
 		// Dispatch all work necessary for this frame render.
-		dispatchFrameJobs(frame_idx, update);
+		++frame_count;
+		dispatchFrameJobs(frame_idx, update, scene_upload.vertex_update, scene_upload.build_update,
+			scene_upload.submitted);
+		scene_upload.submitted = false;
 		// Set image for display.
 		framework->displayFrame(1U, &dispatch_jobs[dispatch_jobs.size() - 1].c_semaphore, frame_idx, present.queue);
 		return true;
@@ -94,6 +123,43 @@ namespace Aura::Core
 		if(result != vk::Result::eSuccess)
 		{ vk::throwResultException(result, "Wait idle."); }
 	}
+	/// <summary>
+	/// Hierarchy builds found in the cache since the framework creation.
+	/// </summary>
+	std::uint32_t Render::getHierarchyCacheHits() const noexcept
+	{
+		return framework->getHierarchyCacheHits();
+	}
+	/// <summary>
+	/// Hierarchy builds not found in the cache since the framework creation.
+	/// </summary>
+	std::uint32_t Render::getHierarchyCacheMisses() const noexcept
+	{
+		return framework->getHierarchyCacheMisses();
+	}
+	/// <summary>
+	/// Mean luminance of the accumulated image, over the pixels with any
+	/// sample. Waits for the device to finish its frames first. Covers the
+	/// last traced tile, the whole image unless tiled.
+	/// </summary>
+	float Render::getMeanLuminance() const
+	{
+		// No frame is in flight once idle, so the release job is free and
+		// the pixels are final.
+		waitIdle();
+		framework->setUpPixelReadback();
+		DispatchJobs const & release_job { release_jobs[0U] };
+		beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, release_job.c_buffer);
+		framework->recordPixelReadback(release_job.c_buffer);
+		endRecord(release_job.c_buffer);
+		vk::SubmitInfo readback {};
+		readback.setCommandBufferCount(1U).setPCommandBuffers(&release_job.c_buffer);
+		compute.queue.submit(1U, &readback, nullptr, dispatch);
+		waitIdle();
+		float const luminance { framework->readMeanLuminance() };
+		framework->tearDownPixelReadback();
+		return luminance;
+	}
 	/// <summary
 	/// Waits for the main fence until all its tasks are finished.
 	/// </summary>
@@ -111,46 +177,125 @@ namespace Aura::Core
 		return true;
 	}
 	/// <summary>
-	/// Checks for any updates in the environment and clones the new states
-	/// to the GPU. Waits for any required work to finish.
+	/// Stages any scene and materials updates and submits their upload, to
+	/// the scene info copy the previous frame does not read. Sets the scene
+	/// upload of the next frame. The upload replays the last one to its
+	/// copy, so the geometry of the last upload is transformed and built
+	/// again on it.
+	/// </summary>
+	void Render::updateScene()
+	{
+		TraversalModes const traversal = framework->sceneTraversal(core_nucleus.display_settings.traversal);
+		HierarchyBuilders const builder = core_nucleus.display_settings.builder;
+		float const refit_threshold = core_nucleus.display_settings.refit_threshold;
+		float const spatial_budget = core_nucleus.display_settings.spatial_budget;
+		std::string const hierarchy_cache = core_nucleus.display_settings.hierarchy_cache;
+
+		// Scene info buffers share the staging slot, so they are updated in
+		// sequence.
+		bool const materials_update { framework->updateMaterials() };
+		bool const scene_update { framework->updateScene(traversal, builder, refit_threshold,
+			spatial_budget, hierarchy_cache) };
+		// Two level traversal reads object space geometry, it is never transformed.
+		bool const vertex_update { scene_update && traversal != TraversalModes::TwoLevel };
+		bool const build_update { vertex_update && traversal == TraversalModes::Hierarchy &&
+			builder == HierarchyBuilders::Device };
+		scene_upload.submitted = submitSceneUpload();
+		scene_upload.update = materials_update || scene_update;
+		scene_upload.vertex_update = vertex_update || (scene_upload.submitted && scene_upload.replay_vertex);
+		scene_upload.build_update = build_update || (scene_upload.submitted && scene_upload.replay_build);
+		scene_upload.replay_vertex = scene_upload.submitted && vertex_update;
+		scene_upload.replay_build = scene_upload.submitted && build_update;
+	}
+	/// <summary>
+	/// Checks for any updates in the rest of the environment and clones the
+	/// new states to the GPU. Waits for any required work to finish. The
+	/// previous frame must be finished. Returns whenever the camera or
+	/// render settings changed.
 	/// </summary>
 	bool Render::updateEnvironment(std::uint32_t const & frame_idx) const
 	{
-		bool update = false;
-		constexpr std::size_t n_jobs { 2U };
+		constexpr std::size_t n_jobs { 1U };
 		constexpr std::size_t n_return_jobs { 2U };
 		std::array<std::future<void>, n_jobs> jobs {};
-		std::array<std::future<bool>, n_jobs> return_jobs {};
+		std::array<std::future<bool>, n_return_jobs> return_jobs {};
 
 		std::uint32_t const n_samples = core_nucleus.display_settings.anti_aliasing == 0 
 			? 1 : core_nucleus.display_settings.anti_aliasing;
 		std::uint32_t const n_bounces = core_nucleus.display_settings.ray_depth;
 		float const t_min = core_nucleus.display_settings.t_min;
 		float const t_max = core_nucleus.display_settings.t_max;
+		TraversalModes const traversal = framework->sceneTraversal(core_nucleus.display_settings.traversal);
+		std::uint32_t const roulette_depth = core_nucleus.display_settings.roulette_depth;
+		float const adaptive_threshold = core_nucleus.display_settings.adaptive_threshold;
+		std::uint32_t const adaptive_min = core_nucleus.display_settings.adaptive_min_samples;
+		bool const next_event = core_nucleus.display_settings.next_event;
 
 		// Enqueue update jobs.
 		jobs[0U] = core_nucleus.enqueue([&] { framework->updateChainImageSet(frame_idx); });
-		jobs[1U] = core_nucleus.enqueue([&] { framework->updateRenderSettings(t_min, t_max, n_samples, n_bounces); });
 		return_jobs[0U] = core_nucleus.enqueue([&] { return framework->updateRayLauncher(); });
-		return_jobs[1U] = core_nucleus.enqueue([&] { return framework->updateScene(); });
+		// Render settings count the lights of the staged scene.
+		return_jobs[1U] = core_nucleus.enqueue([&] {
+			return framework->updateRenderSettings(t_min, t_max, n_samples, n_bounces, traversal,
+				roulette_depth, adaptive_threshold, adaptive_min, next_event); });
 		// Wait for jobs to finish.
 		for(std::size_t i { 0U }; i < n_jobs; ++i)
 		{
 			if(!jobs[i].valid()) { throw std::future_error(std::future_errc::no_state); }
 			jobs[i].wait();
 		}
-		for(std::size_t i { 0U }; i < n_jobs; ++i)
+		for(std::size_t i { 0U }; i < n_return_jobs; ++i)
 		{
-			if(!jobs[i].valid()) { throw std::future_error(std::future_errc::no_state); }
-			update |= return_jobs[i].get();
+			if(!return_jobs[i].valid()) { throw std::future_error(std::future_errc::no_state); }
 		}
-		return update;
+		bool const update = return_jobs[0U].get();
+		bool const settings_update = return_jobs[1U].get();
+		return update || settings_update;
+	}
+	/// <summary>
+	/// Submits the staged scene info updates, and the replay of the last
+	/// upload, to the transfer queue, if any. Buffers of another family are
+	/// released by the compute queue first, and the upload releases them
+	/// back for the frame to acquire. Each copy has its own jobs, the
+	/// previous upload of the copy is done, as its frame was waited on.
+	/// </summary>
+	bool Render::submitSceneUpload() const
+	{
+		if(!framework->uploadPending()) { return false; }
+		std::size_t const copy { (framework->sceneCopy() + 1U) % upload_jobs.size() };
+		DispatchJobs const & release_job { release_jobs[copy] };
+		DispatchJobs const & upload_job { upload_jobs[copy] };
+		bool const handover { transfer.family != compute.family };
+		if(handover)
+		{
+			beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, release_job.c_buffer);
+			framework->recordSceneRelease(release_job.c_buffer);
+			endRecord(release_job.c_buffer);
+			vk::SubmitInfo release {};
+			release.setCommandBufferCount(1U).setPCommandBuffers(&release_job.c_buffer);
+			release.setSignalSemaphoreCount(1U).setPSignalSemaphores(&release_job.c_semaphore);
+			compute.queue.submit(1U, &release, nullptr, dispatch);
+		}
+		beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, upload_job.c_buffer);
+		framework->recordSceneUpload(upload_job.c_buffer);
+		endRecord(upload_job.c_buffer);
+		vk::SubmitInfo upload {};
+		if(handover)
+		{
+			upload.setWaitSemaphoreCount(1U).setPWaitSemaphores(&release_job.c_semaphore);
+			upload.setPWaitDstStageMask(&stage_flags[2U]);
+		}
+		upload.setCommandBufferCount(1U).setPCommandBuffers(&upload_job.c_buffer);
+		upload.setSignalSemaphoreCount(1U).setPSignalSemaphores(&upload_job.c_semaphore);
+		transfer.queue.submit(1U, &upload, nullptr, dispatch);
+		return true;
 	}
 	/// <summary>
 	/// Records and submits all necessary commands to render the image in
-	/// the current settings.
+	/// the current settings, after the scene upload if there is one.
 	/// </summary>
-	void Render::dispatchFrameJobs(std::uint32_t const & frame_idx, bool const & update) const
+	void Render::dispatchFrameJobs(std::uint32_t const & frame_idx, bool const & update,
+		bool const & vertex_update, bool const & build_update, bool const & upload) const
 	{
 		bool is_random = core_nucleus.display_settings.anti_aliasing != 0U;
 		std::size_t n_submits { dispatch_jobs.size() };
@@ -159,13 +304,14 @@ namespace Aura::Core
 
 		// Enqueue thread records and submit info.
 		jobs.resize(n_submits + 1U);
-		jobs[0U] = core_nucleus.enqueue([&] { recordPreProcess(frame_idx, update); });
+		jobs[0U] = core_nucleus.enqueue([&] {
+			recordPreProcess(frame_idx, update, vertex_update, build_update, upload); });
 		for(std::size_t i { 1U }; i < n_submits - 1U; ++i)
 		{
 			jobs[i] = core_nucleus.enqueue([&, is_random, i] { recordSample(is_random, i); });
 		}
 		jobs[n_submits - 1U] = core_nucleus.enqueue([&] { recordPostProcess(frame_idx); });
-		jobs[n_submits] = core_nucleus.enqueue([&] { dispatchSubmitInfo(n_submits, submits); });
+		jobs[n_submits] = core_nucleus.enqueue([&] { dispatchSubmitInfo(n_submits, upload, submits); });
 		// Wait for thread to finish records and submit info.
 		for(std::size_t i { 0U }; i < n_submits + 1U; ++i)
 		{
@@ -180,13 +326,17 @@ namespace Aura::Core
 	// Command recording and submission schedule.
 	// ------------------------------------------------------------------ //
 	/// <summary>
-	/// Builds the entire submit info as necessary for queue submission.
+	/// Builds the entire submit info as necessary for queue submission. The
+	/// first submission waits on the scene upload, if there is one, at the
+	/// stage its acquire is recorded on.
 	/// </summary>
-	void Render::dispatchSubmitInfo(const std::size_t n_submits, std::vector<vk::SubmitInfo> & submits) const
+	void Render::dispatchSubmitInfo(const std::size_t n_submits, bool const upload,
+		std::vector<vk::SubmitInfo> & submits) const
 	{
 		submits.resize(n_submits);
-		submits[0U].setWaitSemaphoreCount(1U).setPWaitSemaphores(&acquisition_semaphore);
-		submits[0U].setPWaitDstStageMask(&stage_flags[1U]);
+		submits[0U].setWaitSemaphoreCount(upload ? 2U : 1U)
+			.setPWaitSemaphores(first_waits[framework->sceneCopy()].data());
+		submits[0U].setPWaitDstStageMask(first_stages.data());
 		submits[0U].setCommandBufferCount(1U).setPCommandBuffers(&dispatch_jobs[0U].c_buffer);
 		submits[0U].setSignalSemaphoreCount(1U).setPSignalSemaphores(&dispatch_jobs[0U].c_semaphore);
 		std::size_t last_idx = 0U;
@@ -201,63 +351,128 @@ namespace Aura::Core
 	}
 	/// <summary>
 	/// Records the layout transition to geral to a initial submission.
+	/// Uploaded scene info is acquired first. The vertex stage only runs
+	/// when the scene geometry was uploaded again, followed by the device
+	/// hierarchy build if requested.
 	/// </summary>
-	void Render::recordPreProcess(std::uint32_t const frame_idx, bool const update) const
+	void Render::recordPreProcess(std::uint32_t const frame_idx, bool const update,
+		bool const vertex_update, bool const build_update, bool const upload) const
 	{
 		DispatchJobs const & pre_process { dispatch_jobs[0U] };
 
 		beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, pre_process.c_buffer);
+		if(upload)
+		{
+			framework->recordSceneAcquire(pre_process.c_buffer);
+		}
 		framework->recordChainImageLayoutTransition(frame_idx,
 			{}, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
 			compute.family, compute.family, stage_flags[1U], stage_flags[1U], pre_process.c_buffer);
+		if constexpr(DebugSettings::intersect_time)
+		{
+			std::uint32_t const n_samples { static_cast<std::uint32_t>(dispatch_jobs.size()) - 2U };
+			framework->recordIntersectQueriesReset(n_samples, core_nucleus.display_settings.ray_depth,
+				pre_process.c_buffer);
+		}
+		// Pixels accumulate across frames, the alpha counting their samples,
+		// until anything the image depends on changes.
 		if(update)
 		{
 			framework->recordPreProcess(pre_process.c_buffer);
+		}
+		if(vertex_update)
+		{
 			framework->recordVertex(pre_process.c_buffer);
 		}
+		if(build_update)
+		{
+			framework->recordHierarchyBuild(pre_process.c_buffer);
+		}
 		endRecord(pre_process.c_buffer);
 	}
 	/// <summary>
 	/// Records a sample sequence in the buffer associated with the sample
-	/// index. Each sequence includes a ray-generation and x sets of 
-	/// intersect, colour and scatter, in this order, equal to the maximum
-	/// depth.
+	/// index, covering a batch of samples. Each sequence includes a
+	/// ray-generation and x sets of intersect, colour and scatter, in this
+	/// order, equal to the maximum depth. With the megakernel backend, where
+	/// supported, the sequence is a single megakernel operation instead, and
+	/// with the fused backend each set is a single bounce operation. Tiles
+	/// are traced one after the other, when tiled the first sample of a tile
+	/// also clears its pixels and the last one writes them to the image.
 	/// </summary>
 	void Render::recordSample(bool const is_random, std::size_t const sample_idx) const
 	{
 		DispatchJobs const & sample { dispatch_jobs[sample_idx] };
+		std::size_t const n_tile_samples { nSampleJobs() };
+		std::size_t const tile_sample { (sample_idx - 1U) % n_tile_samples };
+		bool const tiled { nTiles() > 1U };
+		bool const adaptive { core_nucleus.display_settings.adaptive_threshold > 0.0f };
+		glm::uvec2 const tile { tileOrigin((sample_idx - 1U) / n_tile_samples) };
 		std::uint32_t const n_bounces { core_nucleus.display_settings.ray_depth };
-		RandomSeed rnd_seed {};
-		RandomPointInCircleAndSeed rnd_point {};
+		bool const material_sort { core_nucleus.display_settings.material_sort };
+		bool const ray_sort { core_nucleus.display_settings.ray_sort };
+		// Fused bounces shade straight from their hits, so materials are not sorted.
+		bool const fused { core_nucleus.display_settings.backend == RenderBackends::Fused };
+		bool const next_event { core_nucleus.display_settings.next_event };
+		// Rays draw their random numbers on the device, from the sample.
+		SampleSeed const seed { frame_count, static_cast<std::uint32_t>(sample_idx - 1U), is_random ? 1U : 0U };
 
 		// Record submission.
 		beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, sample.c_buffer);
-		if(is_random) { fillRandoms(rnd_seed); }
-		framework->recordRayGen(rnd_seed, sample.c_buffer);
-		if(n_bounces != 0U)
+		// Tiles share the pixels, so frames are not accumulated when tiled.
+		if(tiled && tile_sample == 0U) { framework->recordPreProcess(sample.c_buffer); }
+		// Pixels converged so far are left out of the sample.
+		if(adaptive) { framework->recordAdaptiveMask(sample.c_buffer); }
+		// Devices without subgroup ballots fall back to the wavefront backend.
+		if(core_nucleus.display_settings.backend == RenderBackends::Megakernel && framework->megakernelSupported())
+		{
+			framework->recordMegakernel(seed, sample.c_buffer, tile);
+			if(tiled && tile_sample + 1U == n_tile_samples) { framework->recordPostProcess(sample.c_buffer, tile); }
+			endRecord(sample.c_buffer);
+			return;
+		}
+		framework->recordRayGen(seed, sample.c_buffer, tile);
+		// Intersections are numbered across the frame, for their timestamps.
+		std::uint32_t const first_intersect { static_cast<std::uint32_t>(sample_idx - 1U) * n_bounces };
+		for(std::uint32_t i { 0U }; i < n_bounces; ++i)
 		{
-			for(std::uint32_t i { 0U }; i < n_bounces - 1U; ++i)
+			// Primary rays are coherent already, only secondary rays are sorted.
+			// Shading reads the last sorted order, by material or by ray.
+			bool const ray_sorted { ray_sort && i != 0U };
+			if(ray_sorted) { framework->recordRaySort(sample.c_buffer, i); }
+			if(fused)
+			{
+				framework->recordBounce(seed, sample.c_buffer, i, ray_sorted);
+			}
+			else
+			{
+				framework->recordIntersect(sample.c_buffer, first_intersect + i, i, ray_sorted);
+				if(material_sort) { framework->recordMaterialSort(sample.c_buffer, i); }
+				framework->recordColourAndScatter(seed, sample.c_buffer, i, material_sort || ray_sorted);
+				// Fused bounces trace their shadow rays themselves.
+				if(next_event) { framework->recordShadows(sample.c_buffer, i); }
+			}
+			// Bounces past the last ray alive dispatch no groups, as their
+			// queues are empty.
+			if constexpr(DebugSettings::active_rays)
 			{
-				framework->recordIntersect(sample.c_buffer);
-				fillRandomsWithinCircle(rnd_point);
-				framework->recordColourAndScatter(rnd_point, sample.c_buffer);
+				framework->recordActiveRays(sample.c_buffer, first_intersect + i, i);
 			}
-			framework->recordIntersect(sample.c_buffer);
-			fillRandomsWithinCircle(rnd_point);
-			framework->recordColourAndScatter(rnd_point, sample.c_buffer);
 		}
+		if(tiled && tile_sample + 1U == n_tile_samples) { framework->recordPostProcess(sample.c_buffer, tile); }
 		endRecord(sample.c_buffer);
 	}
 	/// <summary>
 	/// Records both the post-process and the layout transition, in this order,
-	/// to the same submission.
+	/// to the same submission. When tiled each tile is already written out by
+	/// its last sample, only the transition is left.
 	/// </summary>
 	void Render::recordPostProcess(std::uint32_t const frame_idx) const
 	{
 		DispatchJobs const & post_process { dispatch_jobs[dispatch_jobs.size() - 1U] };
 
 		beginRecord(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, {}, post_process.c_buffer);
-		framework->recordPostProcess(post_process.c_buffer);
+		if(nTiles() == 1U) { framework->recordPostProcess(post_process.c_buffer, glm::uvec2(0U)); }
 		framework->recordChainImageLayoutTransition(frame_idx,
 			vk::AccessFlagBits::eShaderWrite, {}, vk::ImageLayout::eGeneral, vk::ImageLayout::ePresentSrcKHR,
 			compute.family, present.family, stage_flags[1], stage_flags[3], post_process.c_buffer);
@@ -284,34 +499,6 @@ namespace Aura::Core
 		if(result != vk::Result::eSuccess)
 		{ vk::throwResultException(result, "Command::End"); }
 	}
-	/// <summary>
-	/// Randomizes a value limited to a circle with 1 unit radius.
-	/// </summary>
-	glm::vec3 Render::randomInCircle() const
-	{
-		glm::vec3 rand { 0.0, 0.0, 0.0 };
-		do
-		{
-			rand = glm::vec3(core_nucleus.gen(), core_nucleus.gen(), core_nucleus.gen());
-		}
-		while(glm::dot(rand, rand) > 1.0);
-		return rand;
-	}
-	/// <summary>
-	/// Fills structure with a set of a random point and seed.
-	/// </summary>
-	void Render::fillRandomsWithinCircle(RandomPointInCircleAndSeed & randoms) const
-	{
-		randoms.point = randomInCircle();
-		randoms.seed = core_nucleus.gen();
-	}
-	/// <summary>
-	/// Fills structure with generated values.
-	/// </summary>
-	void Render::fillRandoms(RandomSeed & randoms) const
-	{
-		randoms.seed = glm::vec2(core_nucleus.gen(), core_nucleus.gen());
-	}
 
 	// ------------------------------------------------------------------ //
 	// Vulkan set-up and tear-down related.
@@ -597,6 +784,7 @@ namespace Aura::Core
 			surface, base_extent, compute.family, transfer.family, present.family,
 			static_cast<ThreadPool &>(core_nucleus),
 			core_nucleus.display_settings.width, core_nucleus.display_settings.height,
+			sampleBatch(), tileExtent().width, tileExtent().height,
 			core_nucleus.environment.guard, core_nucleus.environment.scene);
 
 		createFence(vk::FenceCreateFlagBits::eSignaled, main_fence);
@@ -618,9 +806,7 @@ namespace Aura::Core
 	/// </summary>
 	void Render::setUpDispatch()
 	{
-		std::size_t n_jobs { core_nucleus.display_settings.anti_aliasing };
-		if(n_jobs == 0) { ++n_jobs; }
-		n_jobs += 2U;
+		std::size_t const n_jobs { nTiles() * nSampleJobs() + 2U };
 		dispatch_jobs.resize(n_jobs);
 		for(std::size_t j_idx { 0U }; j_idx < n_jobs; ++j_idx)
 		{
@@ -630,6 +816,21 @@ namespace Aura::Core
 			allocCommandBuffers(job.c_pool, vk::CommandBufferLevel::ePrimary, 1U, &job.c_buffer);
 			createSemaphore({}, job.c_semaphore);
 		}
+		for(std::size_t c_idx { 0U }; c_idx < upload_jobs.size(); ++c_idx)
+		{
+			DispatchJobs & upload_job = upload_jobs[c_idx];
+			DispatchJobs & release_job = release_jobs[c_idx];
+
+			createCommandPool(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, transfer.family, upload_job.c_pool);
+			allocCommandBuffers(upload_job.c_pool, vk::CommandBufferLevel::ePrimary, 1U, &upload_job.c_buffer);
+			createSemaphore({}, upload_job.c_semaphore);
+			createCommandPool(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, compute.family, release_job.c_pool);
+			allocCommandBuffers(release_job.c_pool, vk::CommandBufferLevel::ePrimary, 1U, &release_job.c_buffer);
+			createSemaphore({}, release_job.c_semaphore);
+			first_waits[c_idx] = { acquisition_semaphore, upload_job.c_semaphore };
+		}
+		// Semaphores are new, so no upload is left for a frame to wait on.
+		scene_upload.submitted = false;
 	}
 	/// <summary>
 	/// Destroys the synchronisation created on the selected device. Must be
@@ -637,9 +838,7 @@ namespace Aura::Core
 	/// </summary>
 	void Render::tearDownDispatch() noexcept
 	{
-		std::size_t n_jobs { core_nucleus.display_settings.anti_aliasing };
-		if(n_jobs == 0) { ++n_jobs; }
-		n_jobs += 2U;
+		std::size_t const n_jobs { nTiles() * nSampleJobs() + 2U };
 		for(std::size_t j_idx { 0U }; j_idx < n_jobs; ++j_idx)
 		{
 			DispatchJobs & job = dispatch_jobs[j_idx];
@@ -648,6 +847,65 @@ namespace Aura::Core
 			freeCommandBuffers(job.c_pool, 1U, &job.c_buffer);
 			destroyCommandPool(job.c_pool);
 		}
+		for(std::size_t c_idx { 0U }; c_idx < upload_jobs.size(); ++c_idx)
+		{
+			DispatchJobs & upload_job = upload_jobs[c_idx];
+			DispatchJobs & release_job = release_jobs[c_idx];
+
+			destroySemaphore(release_job.c_semaphore);
+			freeCommandBuffers(release_job.c_pool, 1U, &release_job.c_buffer);
+			destroyCommandPool(release_job.c_pool);
+			destroySemaphore(upload_job.c_semaphore);
+			freeCommandBuffers(upload_job.c_pool, 1U, &upload_job.c_buffer);
+			destroyCommandPool(upload_job.c_pool);
+		}
+	}
+	/// <summary>
+	/// Samples traced together by each sample submission, at least one.
+	/// </summary>
+	std::uint32_t Render::sampleBatch() const noexcept
+	{
+		return std::max(core_nucleus.display_settings.sample_batch, 1U);
+	}
+	/// <summary>
+	/// Sample submissions per frame, enough whole batches to cover the
+	/// anti-aliasing samples.
+	/// </summary>
+	std::size_t Render::nSampleJobs() const noexcept
+	{
+		std::size_t const n_samples { std::max(core_nucleus.display_settings.anti_aliasing, 1U) };
+		return (n_samples + sampleBatch() - 1U) / sampleBatch();
+	}
+	/// <summary>
+	/// Traced tile dimensions, the image dimensions if not tiled. Edge tiles
+	/// may reach past the image.
+	/// </summary>
+	vk::Extent2D Render::tileExtent() const noexcept
+	{
+		DisplaySettings const & settings { core_nucleus.display_settings };
+		if(settings.tile_size == 0U) { return vk::Extent2D(settings.width, settings.height); }
+		return vk::Extent2D(std::min(settings.tile_size, settings.width), std::min(settings.tile_size, settings.height));
+	}
+	/// <summary>
+	/// Tiles covering the image.
+	/// </summary>
+	std::size_t Render::nTiles() const noexcept
+	{
+		DisplaySettings const & settings { core_nucleus.display_settings };
+		vk::Extent2D const tile { tileExtent() };
+		std::size_t const columns { (settings.width + tile.width - 1U) / tile.width };
+		std::size_t const rows { (settings.height + tile.height - 1U) / tile.height };
+		return columns * rows;
+	}
+	/// <summary>
+	/// Image origin of the given tile, tiles are numbered row by row.
+	/// </summary>
+	glm::uvec2 Render::tileOrigin(std::size_t const tile_idx) const noexcept
+	{
+		vk::Extent2D const tile { tileExtent() };
+		std::size_t const columns { (core_nucleus.display_settings.width + tile.width - 1U) / tile.width };
+		return glm::uvec2(static_cast<std::uint32_t>(tile_idx % columns) * tile.width,
+			static_cast<std::uint32_t>(tile_idx / columns) * tile.height);
 	}
 
 	// ------------------------------------------------------------------ //
@@ -6,15 +6,23 @@
 // Internal includes.
 #include <Aura/Core/settings.hpp>
 #include <Aura/Core/Environment/structures.hpp>
+#include <Aura/Core/Environment/hierarchy.hpp>
+#include <Aura/Core/Environment/hierarchy-cache.hpp>
+#include <Aura/Core/Environment/lights.hpp>
 #include <Aura/Core/nucleus.hpp>
 // Standard includes.
+#include <cmath>
 #include <cstdint>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <mutex>
 #include <future>
+#include <limits>
 #include <thread>
 #include <shared_mutex>
 #include <string>
+#include <vector>
 // External includes.
 #pragma warning(disable : 26495 26812)
 #include <gtest/gtest.h>
@@ -71,6 +79,15 @@ namespace Aura::Test
 		/// Auxiliary cuboid insert.
 		/// </summary>
 		bool addCuboid(Core::Vertex v0, Core::Vertex v1, Core::Material material, std::uint32_t & e_idx)
+		{
+			std::uint32_t material_idx { 0U };
+			if(!core->environment.newMaterial(material, material_idx)) { return false; }
+			return addCuboid(v0, v1, material_idx, e_idx);
+		}
+		/// <summary>
+		/// Auxiliary cuboid insert, with an existing material.
+		/// </summary>
+		bool addCuboid(Core::Vertex v0, Core::Vertex v1, std::uint32_t const material_idx, std::uint32_t & e_idx)
 		{
 			std::uint32_t tmp_idx { 0U };
 			Core::Primitive primitive
@@ -78,8 +95,7 @@ namespace Aura::Test
 				Core::Primitive::Types::Cuboid, 0U, 0U, 0.0f,
 				glm::uvec4(0U, 0U, 0U, 0U)
 			};
-			if(!core->environment.newMaterial(material, tmp_idx)) { return false; }
-			if(!core->environment.newEntity(tmp_idx, e_idx)) { return false; }
+			if(!core->environment.newEntity(material_idx, e_idx)) { return false; }
 			if(!core->environment.newVertex(v0, tmp_idx)) { return false; }
 			primitive.vertices.x = tmp_idx;
 			if(!core->environment.newVertex(v1, tmp_idx)) { return false; }
@@ -118,6 +134,120 @@ namespace Aura::Test
 		}
 	};
 
+	/// <summary>
+	/// Host built structures test fixture, needs no device.
+	/// </summary>
+	class HostEnv : public ::testing::Test
+	{
+	protected:
+		/// <summary>
+		/// Unit boxes on a cubic grid of the given side, two units apart.
+		/// </summary>
+		static std::vector<Core::Bounds> gridBounds(std::uint32_t const side)
+		{
+			std::vector<Core::Bounds> bounds {};
+			for(std::uint32_t i { 0U }; i < side * side * side; ++i)
+			{
+				glm::vec3 const min { 2.0f * glm::vec3(i % side, (i / side) % side, i / (side * side)) };
+				bounds.emplace_back(Core::Bounds { min, min + 1.0f });
+			}
+			return bounds;
+		}
+		/// <summary>
+		/// Checks if the outer box contains the inner one.
+		/// </summary>
+		static bool contains(glm::vec3 const & min, glm::vec3 const & max, Core::Bounds const & inner)
+		{
+			return glm::all(glm::lessThanEqual(min, inner.min)) && glm::all(glm::greaterThanEqual(max, inner.max));
+		}
+		/// <summary>
+		/// Checks that every node box contains its children, which follow it,
+		/// or the boxes of its referenced primitives.
+		/// </summary>
+		static bool nodesContain(Core::Hierarchy const & hierarchy, std::vector<Core::Bounds> const & bounds)
+		{
+			for(std::size_t i { 0U }; i < hierarchy.nodes.size(); ++i)
+			{
+				Core::Node const & node { hierarchy.nodes[i] };
+				if(node.left & Core::Hierarchy::leaf_flag)
+				{
+					std::uint32_t const first { node.left & ~Core::Hierarchy::leaf_flag };
+					if(first + node.right > hierarchy.references.size()) { return false; }
+					for(std::uint32_t r { first }; r < first + node.right; ++r)
+					{
+						if(!contains(node.min, node.max, bounds[hierarchy.references[r]])) { return false; }
+					}
+				}
+				else
+				{
+					for(std::uint32_t const child : { node.left, node.right })
+					{
+						if(child <= i || child >= hierarchy.nodes.size()) { return false; }
+						Core::Node const & c { hierarchy.nodes[child] };
+						if(!contains(node.min, node.max, Core::Bounds { c.min, c.max })) { return false; }
+					}
+				}
+			}
+			return true;
+		}
+		/// <summary>
+		/// Next number of a fixed linear congruential sequence, in [0, 1).
+		/// Keeps the host tests the same on every run.
+		/// </summary>
+		static float random(std::uint32_t & state) noexcept
+		{
+			state = state * 1664525U + 1013904223U;
+			return static_cast<float>(state >> 8U) / 16777216.0f;
+		}
+		/// <summary>
+		/// Checks that every child box decoded from the wide nodes under the
+		/// given one contains the boxes of all references below it. Adds the
+		/// references found to the list.
+		/// </summary>
+		static bool wideContain(Core::WideHierarchy const & wide, Core::Hierarchy const & binary,
+			std::vector<Core::Bounds> const & bounds, std::uint32_t const node,
+			std::vector<std::uint32_t> & references)
+		{
+			Core::WideNode const & w { wide.nodes[node] };
+			glm::vec3 step {};
+			for(std::uint32_t a { 0U }; a < 3U; ++a)
+			{
+				step[a] = std::ldexp(1.0f, static_cast<int>((w.exponents >> (8U * a)) & 0xFFU) - 127);
+			}
+			for(std::uint32_t i { 0U }; i < Core::WideHierarchy::width; ++i)
+			{
+				std::uint32_t const child { w.children[i] };
+				if(child == Core::WideHierarchy::empty_child) { continue; }
+				std::uint32_t const shift { 8U * i };
+				glm::vec3 const lo { (w.bounds_xy[0U] >> shift) & 0xFFU,
+					(w.bounds_xy[2U] >> shift) & 0xFFU, (w.bounds_z[0U] >> shift) & 0xFFU };
+				glm::vec3 const hi { (w.bounds_xy[1U] >> shift) & 0xFFU,
+					(w.bounds_xy[3U] >> shift) & 0xFFU, (w.bounds_z[1U] >> shift) & 0xFFU };
+				glm::vec3 const min { w.origin + lo * step };
+				glm::vec3 const max { w.origin + hi * step };
+				std::vector<std::uint32_t> below {};
+				if(child & Core::Hierarchy::leaf_flag)
+				{
+					std::uint32_t const first { child & ~Core::Hierarchy::leaf_flag };
+					std::uint32_t const count { (w.bounds_z[2U] >> shift) & 0xFFU };
+					if(first + count > binary.references.size()) { return false; }
+					below.assign(binary.references.begin() + first, binary.references.begin() + first + count);
+				}
+				else
+				{
+					if(child <= node || child >= wide.nodes.size()) { return false; }
+					if(!wideContain(wide, binary, bounds, child, below)) { return false; }
+				}
+				for(std::uint32_t const r : below)
+				{
+					if(!contains(min, max, bounds[r])) { return false; }
+				}
+				references.insert(references.end(), below.begin(), below.end());
+			}
+			return true;
+		}
+	};
+
 	// ------------------------------------------------------------------ //
 	// Base tests.
 	// ------------------------------------------------------------------ //
@@ -256,6 +386,545 @@ namespace Aura::Test
 		core->run(60U, "../results.txt");
 		ASSERT_TRUE(core->frame_counter >= 60U);
 	}
+	TEST_F(CoreEnv, LinearSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.traversal = Core::TraversalModes::Linear;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_linear.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.traversal = Core::TraversalModes::Hierarchy;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, TwoLevelSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.traversal = Core::TraversalModes::TwoLevel;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_two_level.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.traversal = Core::TraversalModes::Hierarchy;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, WideSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.traversal = Core::TraversalModes::Wide;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_wide.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.traversal = Core::TraversalModes::Hierarchy;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, HierarchyCacheSixtyFrameLoop)
+	{
+		// Mesh bottom levels are built once per run and written to the cache
+		// in the background, later runs load them back. Switching traversal
+		// away and back builds the same scene again, which must load every
+		// bottom level.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.traversal = Core::TraversalModes::TwoLevel;
+		settings.hierarchy_cache = "../hierarchy_cache";
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_hierarchy_cache.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		ASSERT_FALSE(std::filesystem::is_empty(settings.hierarchy_cache));
+		std::uint32_t const hits { core->getHierarchyCacheHits() };
+		settings.traversal = Core::TraversalModes::Hierarchy;
+		core->updateDisplaySettings(settings);
+		core->run(1U, "../results_hierarchy_cache.txt");
+		settings.traversal = Core::TraversalModes::TwoLevel;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_hierarchy_cache_hit.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		ASSERT_GT(core->getHierarchyCacheHits(), hits);
+		settings.traversal = Core::TraversalModes::Hierarchy;
+		settings.hierarchy_cache.clear();
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, SpatialBuilderSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.builder = Core::HierarchyBuilders::Spatial;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_spatial_builder.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.builder = Core::HierarchyBuilders::Host;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, DeviceBuilderSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.builder = Core::HierarchyBuilders::Device;
+		core->updateDisplaySettings(settings);
+		// Move an entity so the scene is transformed and built again. Each
+		// build is checked against a host built reference with
+		// DebugSettings::validate_hierarchy.
+		core->environment.entityTranslate(0U, glm::vec3(0.0f, -2.1f, 0.0f));
+		core->run(60U, "../results_device_builder.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.builder = Core::HierarchyBuilders::Host;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, RefitSixtyFrameLoop)
+	{
+		// Small transform only steps, refitted on the host between runs. The
+		// translation is absolute, so the floor moves further from its place
+		// on every step and is put back at the end. Refit boxes and the
+		// refit or rebuild decision are checked by HostEnv.HierarchyRefit.
+		for(std::uint32_t step { 1U }; step <= 6U; ++step)
+		{
+			float const offset { 0.05f * static_cast<float>(step) };
+			core->environment.entityTranslate(0U, glm::vec3(0.0f, -2.1f + offset, 0.0f));
+			core->run(10U, "../results_refit.txt");
+		}
+		ASSERT_TRUE(core->frame_counter >= 10U);
+		core->environment.entityTranslate(0U, glm::vec3(0.0f, -2.1f, 0.0f));
+	}
+	TEST_F(CoreEnv, SuzanneSixtyFrameLoop)
+	{
+		// Closed mesh with many shared edges, any hole shows in the image.
+		std::uint32_t e_idx { 0U };
+		Core::Material material
+		{
+			glm::vec4(0.75f, 0.5f, 0.5f, 0.0f),
+			Core::Material::Types::Diffuse, 0.0f, 0.0f
+		};
+		ASSERT_TRUE(addModel("models/suzanne.obj", material, e_idx));
+		core->environment.entityScale(e_idx, glm::vec3(0.5f, 0.5f, 0.5f));
+		core->environment.entityTranslate(e_idx, glm::vec3(0.0f, 0.5f, -0.5f));
+		core->run(60U, "../results_suzanne.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+	}
+	TEST_F(CoreEnv, OrientedCuboidSixtyFrameLoop)
+	{
+		// Same box as the cube model, as a single rotated cuboid. The box
+		// materials are all taken, it shares the diffuse green wall one.
+		std::uint32_t const material_idx { 2U };
+		std::uint32_t e_idx { 0U };
+		Core::Vertex cuboid_v0 { glm::vec3(-0.5f, -0.5f, -0.5f) };
+		Core::Vertex cuboid_v1 { glm::vec3(0.5f, 0.5f, 0.5f) };
+		ASSERT_TRUE(addCuboid(cuboid_v0, cuboid_v1, material_idx, e_idx));
+		core->environment.entityScale(e_idx, glm::vec3(0.5f, 0.5f, 0.5f));
+		core->environment.entityTranslate(e_idx, glm::vec3(-1.0f, 0.5f, 0.0f));
+		core->environment.entityRotate(e_idx, glm::vec3(0.3f, 0.6f, 0.0f));
+		// Built on the device, so with DebugSettings::validate_hierarchy its
+		// rotated box is checked against the one the host bounds it with.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.builder = Core::HierarchyBuilders::Device;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_oriented_cuboid.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.builder = Core::HierarchyBuilders::Host;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, MaterialSortSixtyFrameLoop)
+	{
+		// The box mixes diffuse, specular and emissive materials from the
+		// first bounce.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.material_sort = true;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_material_sort.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.material_sort = false;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, RaySortSixtyFrameLoop)
+	{
+		// Secondary intersections are timed apart with
+		// DebugSettings::intersect_time.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.ray_sort = true;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_ray_sort.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.ray_sort = false;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, MegakernelSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.backend = Core::RenderBackends::Megakernel;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_megakernel.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.backend = Core::RenderBackends::Wavefront;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, FusedSixtyFrameLoop)
+	{
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.backend = Core::RenderBackends::Fused;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_fused_bounce.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.backend = Core::RenderBackends::Wavefront;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, SampleBatchSixtyFrameLoop)
+	{
+		// Eight samples per frame, traced together instead of chained.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		std::uint32_t const anti_aliasing { settings.anti_aliasing };
+		settings.anti_aliasing = 8U;
+		settings.sample_batch = 8U;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_batched_samples.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.anti_aliasing = anti_aliasing;
+		settings.sample_batch = 1U;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, RouletteSixtyFrameLoop)
+	{
+		// Deep paths, rays alive per bounce are output with
+		// DebugSettings::active_rays. Each settings change restarts the
+		// accumulation, so both images only hold their own samples. Paths
+		// stopped by the roulette count with no colour and survivors are
+		// weighted up, so the image keeps its brightness.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		std::uint32_t const ray_depth { settings.ray_depth };
+		settings.ray_depth = 32U;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_deep.txt");
+		float const luminance { core->getMeanLuminance() };
+		settings.roulette_depth = 3U;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_deep_roulette.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		ASSERT_GT(luminance, 0.0f);
+		EXPECT_NEAR(core->getMeanLuminance(), luminance, 0.02f * luminance);
+		settings.ray_depth = ray_depth;
+		settings.roulette_depth = 0U;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, TiledSixtyFrameLoop)
+	{
+		// Edge tiles of the default image reach past it.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.tile_size = 256U;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_tiled.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.tile_size = 0U;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, AccumulationSixtyFrameLoop)
+	{
+		// A still view accumulates every frame, a render settings change
+		// restarts it without recreating the framework.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		std::uint32_t const ray_depth { settings.ray_depth };
+		core->run(60U, "../results_accumulated.txt");
+		settings.ray_depth = ray_depth + 1U;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_accumulation_reset.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.ray_depth = ray_depth;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, AdaptiveSixtyFrameLoop)
+	{
+		// Converged pixels drop out as frames accumulate.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.adaptive_threshold = 0.05f;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_adaptive_sampling.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.adaptive_threshold = 0.0f;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, NextEventSixtyFrameLoop)
+	{
+		// Lights sampled at every diffuse hit, each through a shadow ray.
+		Core::DisplaySettings settings { core->getDisplaySettings() };
+		settings.next_event = true;
+		core->updateDisplaySettings(settings);
+		core->run(60U, "../results_next_event.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+		settings.next_event = false;
+		core->updateDisplaySettings(settings);
+	}
+	TEST_F(CoreEnv, InstancingSixtyFrameLoop)
+	{
+		// Suzanne placed on a grid, sharing the primitives of a source hidden
+		// behind the box. Instances are only drawn by the two level
+		// traversal, so the scene uses it whatever the display settings say.
+		// Instances are never removed, so this test runs last.
+		std::uint32_t source_idx { 0U };
+		Core::Material material
+		{
+			glm::vec4(0.5f, 0.5f, 0.75f, 0.0f),
+			Core::Material::Types::Diffuse, 0.0f, 0.0f
+		};
+		ASSERT_TRUE(addModel("models/suzanne.obj", material, source_idx));
+		core->environment.entityTranslate(source_idx, glm::vec3(0.0f, 0.0f, -10.0f));
+		std::uint32_t e_idx { 0U };
+		for(std::uint32_t i { 0U }; i < 16U; ++i)
+		{
+			ASSERT_TRUE(core->environment.newInstance(source_idx, i % 4U, e_idx));
+			core->environment.entityScale(e_idx, glm::vec3(0.2f, 0.2f, 0.2f));
+			core->environment.entityTranslate(e_idx, glm::vec3(
+				-1.5f + static_cast<float>(i % 4U), -1.5f + static_cast<float>(i / 4U), 0.5f));
+		}
+		ASSERT_EQ(core->getDisplaySettings().traversal, Core::TraversalModes::Hierarchy);
+		core->run(60U, "../results_instancing.txt");
+		ASSERT_TRUE(core->frame_counter >= 60U);
+	}
+
+	// ------------------------------------------------------------------ //
+	// Host tests.
+	// ------------------------------------------------------------------ //
+	TEST_F(HostEnv, HierarchyRefit)
+	{
+		std::vector<Core::Bounds> bounds { gridBounds(4U) };
+		Core::Hierarchy hierarchy {};
+		hierarchy.build(bounds);
+		ASSERT_TRUE(nodesContain(hierarchy, bounds));
+		// An unchanged scene keeps the cost of its build.
+		EXPECT_FLOAT_EQ(hierarchy.refit(bounds), 1.0f);
+		// Boxes refit after a small step still hold every primitive, and the
+		// refit is kept.
+		float const threshold { Core::DisplaySettings {}.refit_threshold };
+		std::vector<Core::Bounds> stepped { bounds };
+		stepped[0U].min += 0.5f;
+		stepped[0U].max += 0.5f;
+		float const step_ratio { hierarchy.refit(stepped) };
+		EXPECT_TRUE(nodesContain(hierarchy, stepped));
+		EXPECT_LE(step_ratio, threshold);
+		// Scattering the boxes across the grid leaves every node spanning
+		// most of the scene, which must trigger a rebuild.
+		std::vector<Core::Bounds> scattered(bounds.size());
+		for(std::size_t i { 0U }; i < bounds.size(); ++i)
+		{
+			scattered[i] = bounds[(i * 29U + 7U) % bounds.size()];
+		}
+		float const scatter_ratio { hierarchy.refit(scattered) };
+		EXPECT_TRUE(nodesContain(hierarchy, scattered));
+		EXPECT_GT(scatter_ratio, threshold);
+	}
+	TEST_F(HostEnv, WideHierarchy)
+	{
+		// Scattered boxes of every size, plus a pile of equal ones that ends
+		// in a leaf too big for the counts byte.
+		std::uint32_t state { 1U };
+		std::vector<Core::Bounds> bounds {};
+		for(std::uint32_t i { 0U }; i < 1000U; ++i)
+		{
+			glm::vec3 const min { random(state) * 100.0f, random(state) * 100.0f, random(state) * 0.01f };
+			glm::vec3 const size { random(state) * 10.0f, random(state) * 0.1f, random(state) * 1000.0f };
+			bounds.emplace_back(Core::Bounds { min, min + size });
+		}
+		bounds.resize(bounds.size() + 300U, Core::Bounds { glm::vec3(50.0f), glm::vec3(51.0f) });
+		Core::Hierarchy binary {};
+		binary.build(bounds);
+		Core::WideHierarchy wide {};
+		wide.build(binary);
+		ASSERT_FALSE(wide.nodes.empty());
+		// Quantized boxes round outwards, so they hold every reference, and
+		// no primitive is lost on the way.
+		std::vector<std::uint32_t> references {};
+		ASSERT_TRUE(wideContain(wide, binary, bounds, 0U, references));
+		std::vector<std::uint32_t> counts(bounds.size(), 0U);
+		for(std::uint32_t const r : references) { ++counts[r]; }
+		for(std::uint32_t const count : counts) { EXPECT_EQ(count, 1U); }
+	}
+	TEST_F(HostEnv, SpatialBuilder)
+	{
+		// Long thin triangles crossing the scene, which overlap on every
+		// object split.
+		std::uint32_t state { 7U };
+		std::vector<Core::Triangle> triangles {};
+		std::vector<Core::Bounds> bounds {};
+		for(std::uint32_t i { 0U }; i < 512U; ++i)
+		{
+			glm::vec3 const v0 { random(state) * 10.0f, random(state) * 10.0f, random(state) * 10.0f };
+			glm::vec3 const v1 { random(state) * 10.0f, random(state) * 10.0f, random(state) * 10.0f };
+			Core::Triangle const & triangle { triangles.emplace_back(Core::Triangle {
+				v0, v1, v1 + glm::vec3(0.01f), true }) };
+			Core::Bounds & box { bounds.emplace_back() };
+			box.grow(triangle.v0);
+			box.grow(triangle.v1);
+			box.grow(triangle.v2);
+		}
+		// Empty boxes are never referenced.
+		bounds.emplace_back();
+		triangles.emplace_back();
+		auto const n { static_cast<std::uint32_t>(triangles.size() - 1U) };
+		float const budget { Core::DisplaySettings {}.spatial_budget };
+		Core::Hierarchy hierarchy {};
+		hierarchy.buildSpatial(bounds, triangles, budget);
+		// Split references stay within the budget, and every primitive is
+		// referenced at least once.
+		EXPECT_GT(hierarchy.references.size(), n);
+		EXPECT_LE(hierarchy.references.size(), n + static_cast<std::uint32_t>(budget * static_cast<float>(n)));
+		std::vector<std::uint32_t> counts(bounds.size(), 0U);
+		for(std::uint32_t const r : hierarchy.references)
+		{
+			ASSERT_LT(r, n);
+			++counts[r];
+		}
+		for(std::uint32_t i { 0U }; i < n; ++i) { EXPECT_GE(counts[i], 1U); }
+		// Leaves only hold the clipped part of a reference, so they overlap
+		// its box instead of containing it. Parents still contain children.
+		for(std::size_t i { 0U }; i < hierarchy.nodes.size(); ++i)
+		{
+			Core::Node const & node { hierarchy.nodes[i] };
+			if(node.left & Core::Hierarchy::leaf_flag)
+			{
+				std::uint32_t const first { node.left & ~Core::Hierarchy::leaf_flag };
+				ASSERT_LE(first + node.right, hierarchy.references.size());
+				for(std::uint32_t r { first }; r < first + node.right; ++r)
+				{
+					Core::Bounds const & box { bounds[hierarchy.references[r]] };
+					EXPECT_TRUE(glm::all(glm::lessThanEqual(node.min, box.max)) &&
+						glm::all(glm::greaterThanEqual(node.max, box.min)));
+				}
+				continue;
+			}
+			for(std::uint32_t const child : { node.left, node.right })
+			{
+				ASSERT_GT(child, i);
+				ASSERT_LT(child, hierarchy.nodes.size());
+				Core::Node const & c { hierarchy.nodes[child] };
+				EXPECT_TRUE(contains(node.min, node.max, Core::Bounds { c.min, c.max }));
+			}
+		}
+	}
+	TEST_F(HostEnv, LightList)
+	{
+		float const pi { 3.14159265f };
+		// Emissive unit cuboid scaled twice and moved, an emissive sphere of
+		// radius 0.5 and a diffuse triangle, all on one entity.
+		std::vector<Core::Vertex> const vertices {
+			{ glm::vec3(-0.5f) }, { glm::vec3(0.5f) }, { glm::vec3(3.0f, 0.0f, 0.0f) },
+			{ glm::vec3(0.0f) }, { glm::vec3(1.0f, 0.0f, 0.0f) }, { glm::vec3(0.0f, 1.0f, 0.0f) } };
+		std::vector<Core::Material> const materials {
+			{ glm::vec4(1.0f), Core::Material::Types::Emissive, 0.0f, 0.0f },
+			{ glm::vec4(1.0f), Core::Material::Types::Diffuse, 0.0f, 0.0f } };
+		std::vector<Core::Primitive> const primitives {
+			{ Core::Primitive::Types::Cuboid, 0U, 0U, 0.0f, glm::uvec4(0U, 1U, 0U, 0U) },
+			{ Core::Primitive::Types::Sphere, 0U, 0U, 0.5f, glm::uvec4(2U, 0U, 0U, 0U) },
+			{ Core::Primitive::Types::Triangle, 0U, 1U, 0.0f, glm::uvec4(3U, 4U, 5U, 0U) } };
+		std::vector<Core::Transform> transforms(1U);
+		transforms[0U].scaling = glm::scale(glm::identity<glm::mat4>(), glm::vec3(2.0f));
+		transforms[0U].translation = glm::translate(glm::identity<glm::mat4>(), glm::vec3(5.0f, 0.0f, 0.0f));
+		std::vector<Core::Entity> entities(1U);
+		entities[0U].primitives = { 0U, 1U, 2U };
+		Core::LightList lights {};
+		lights.build(entities, primitives, vertices, transforms, materials);
+		// Twelve face triangles of a side 2 cube, then a sphere of radius 1.
+		ASSERT_EQ(lights.records.size(), 13U);
+		float const cube_area { 6.0f * 2.0f * 2.0f };
+		float const sphere_area { 4.0f * pi };
+		EXPECT_NEAR(lights.area, cube_area + sphere_area, 1e-4f);
+		float sum { 0.0f };
+		for(std::size_t i { 0U }; i < lights.records.size(); ++i)
+		{
+			Core::LightRecord const & light { lights.records[i] };
+			EXPECT_EQ(light.material_idx, 0U);
+			if(i < 12U)
+			{
+				EXPECT_EQ(light.type, Core::Primitive::Types::Triangle);
+				EXPECT_NEAR(light.area, 2.0f, 1e-5f);
+			}
+			else
+			{
+				EXPECT_EQ(light.type, Core::Primitive::Types::Sphere);
+				EXPECT_NEAR(light.radius, 1.0f, 1e-6f);
+				EXPECT_NEAR(light.area, sphere_area, 1e-5f);
+				// Sphere centres are moved, but never scaled.
+				EXPECT_NEAR(light.v0.x, 8.0f, 1e-5f);
+			}
+			// Picked by area, the distribution closes at one.
+			sum += light.area;
+			EXPECT_NEAR(light.cdf, sum / lights.area, 1e-6f);
+			if(i > 0U) { EXPECT_GE(light.cdf, lights.records[i - 1U].cdf); }
+		}
+		EXPECT_EQ(lights.records.back().cdf, 1.0f);
+		// Instances add the lights of their source. Their emissive material
+		// replaces the primitive ones, so the triangle lights as well.
+		entities.emplace_back().source_idx = 0U;
+		lights.build(entities, primitives, vertices, transforms, materials);
+		EXPECT_EQ(lights.records.size(), 27U);
+		// Lights left out would still be weighted as lights when hit, so
+		// too many fail the build.
+		std::vector<Core::Entity> crowd(Core::EnvLimits::limit_lights / 12U + 1U);
+		for(Core::Entity & entity : crowd) { entity.primitives = { 0U }; }
+		EXPECT_ANY_THROW(lights.build(crowd, primitives, vertices, transforms, materials));
+	}
+	TEST_F(HostEnv, HierarchyCache)
+	{
+		std::filesystem::path const directory { std::filesystem::temp_directory_path() / "aura_cache_test" };
+		std::filesystem::remove_all(directory);
+		std::vector<Core::Bounds> const bounds { gridBounds(4U) };
+		std::uint64_t const key { 0x1234U };
+		Core::Hierarchy built {};
+		{
+			// A miss builds and is only written on the flush.
+			Core::HierarchyCache cache {};
+			cache.directory = directory;
+			ASSERT_FALSE(cache.build(key, bounds, built));
+			EXPECT_EQ(cache.misses, 1U);
+			cache.flush();
+			cache.wait();
+			ASSERT_TRUE(nodesContain(built, bounds));
+		}
+		std::vector<std::filesystem::path> files {};
+		for(std::filesystem::directory_entry const & entry : std::filesystem::directory_iterator(directory))
+		{
+			files.emplace_back(entry.path());
+		}
+		ASSERT_EQ(files.size(), 1U);
+		std::filesystem::path const & file { files[0U] };
+		// Another cache on the same directory loads the same hierarchy.
+		{
+			Core::HierarchyCache cache {};
+			cache.directory = directory;
+			Core::Hierarchy loaded {};
+			ASSERT_TRUE(cache.build(key, bounds, loaded));
+			EXPECT_EQ(cache.hits, 1U);
+			ASSERT_EQ(loaded.nodes.size(), built.nodes.size());
+			for(std::size_t i { 0U }; i < built.nodes.size(); ++i)
+			{
+				EXPECT_EQ(loaded.nodes[i].min, built.nodes[i].min);
+				EXPECT_EQ(loaded.nodes[i].max, built.nodes[i].max);
+				EXPECT_EQ(loaded.nodes[i].left, built.nodes[i].left);
+				EXPECT_EQ(loaded.nodes[i].right, built.nodes[i].right);
+			}
+			EXPECT_EQ(loaded.references, built.references);
+			EXPECT_FLOAT_EQ(loaded.build_cost, built.build_cost);
+			// Other keys or box counts never match the file.
+			EXPECT_FALSE(cache.build(key + 1U, bounds, loaded));
+			EXPECT_FALSE(cache.build(key, gridBounds(3U), loaded));
+		}
+		std::uintmax_t const size { std::filesystem::file_size(file) };
+		// A reference past the boxes is rejected, and the miss rebuilt.
+		{
+			std::fstream stream(file, std::ios::binary | std::ios::in | std::ios::out);
+			stream.seekp(static_cast<std::streamoff>(size - sizeof(std::uint32_t)));
+			std::uint32_t const reference { static_cast<std::uint32_t>(bounds.size()) };
+			stream.write(reinterpret_cast<char const *>(&reference), sizeof(reference));
+		}
+		{
+			Core::HierarchyCache cache {};
+			cache.directory = directory;
+			Core::Hierarchy rebuilt {};
+			EXPECT_FALSE(cache.build(key, bounds, rebuilt));
+			EXPECT_EQ(rebuilt.references, built.references);
+		}
+		// So is a file cut short.
+		std::filesystem::resize_file(file, size / 2U);
+		{
+			Core::HierarchyCache cache {};
+			cache.directory = directory;
+			Core::Hierarchy rebuilt {};
+			EXPECT_FALSE(cache.build(key, bounds, rebuilt));
+			EXPECT_EQ(cache.misses, 1U);
+		}
+		std::filesystem::remove_all(directory);
+	}
 	/*
 	TEST_F(CoreEnv, InfLoop)
 	{